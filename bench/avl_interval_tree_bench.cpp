@@ -0,0 +1,68 @@
+#include <avl_interval_tree.hpp>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+
+/**
+ * @brief Gera n intervalos com início uniforme em [0, 10n) e comprimento
+ *        até 100, ordenados pelo início
+ */
+static std::vector<avl_interval<int> > random_intervals(long n) {
+    std::mt19937 rng(42);
+    std::vector<avl_interval<int> > v;
+
+    for (long i = 0; i < n; i++) {
+        int low = (int) (rng() % (10 * n));
+        v.push_back(avl_interval<int>(low, low + (int) (rng() % 101)));
+    }
+
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+
+    return v;
+}
+
+/**
+ * @brief Busca de intervalos sobrepostos a uma janela curta
+ *
+ * Sem o aumento, a árvore é só ordenada pelo início e a busca percorre
+ * todos os intervalos que começam antes do fim da janela.
+ */
+template <bool Augmented> static void BM_Overlapping(benchmark::State& state) {
+    typedef avl_interval<int> interval;
+
+    const long n = state.range(0);
+    std::vector<interval> v = random_intervals(n);
+
+    avl_interval_tree<int> augmented;
+    avl_tree<interval> plain;
+
+    if (Augmented) {
+        for (const interval& i : v)
+            augmented.insert(i.low, i.high);
+    } else {
+        plain.build(v.begin(), v.end());
+    }
+
+    std::mt19937 rng(3);
+    long found = 0;
+
+    for (auto _ : state) {
+        int a = (int) (rng() % (10 * n)), b = a + 10;
+
+        if (Augmented) {
+            augmented.overlapping(a, b, [&](const interval&) { found++; });
+        } else {
+            for (auto it = plain.begin_in_order(); it != plain.end_in_order() && it->low <= b; ++it)
+                if (it->overlaps(a, b))
+                    found++;
+        }
+    }
+
+    benchmark::DoNotOptimize(found);
+    state.SetItemsProcessed(state.iterations());
+    state.counters["found/op"] = state.iterations() ? (double) found / state.iterations() : 0;
+}
+BENCHMARK_TEMPLATE(BM_Overlapping, true)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(BM_Overlapping, false)->Arg(1000)->Arg(1000000);
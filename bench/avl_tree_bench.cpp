@@ -0,0 +1,883 @@
+#include <avl_tree.hpp>
+#include <avl_tree_augment.hpp>
+#include <avl_tree_stats.hpp>
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <set>
+#include <string>
+
+#include "bench_util.hpp"
+
+std::atomic<unsigned long> bench_allocations(0);
+
+void* operator new(size_t n) {
+    bench_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+/**
+ * @brief Operações de avl_tree usadas pelos benchmarks
+ *
+ * @tparam Stats Política de instrumentação da árvore
+ */
+template <class Stats> struct basic_avl_ops {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, Stats> container;
+    typedef typename container::inorder_iterator hint;
+
+    static void fill(container& c, const std::vector<int>& sorted) {
+        c.build(sorted.begin(), sorted.end());
+    }
+
+    static void insert(container& c, int key) { c.insert(key); }
+    static void remove(container& c, int key) { c.remove(key); }
+    static bool find(const container& c, int key) { return c.includes(key); }
+    static void update(container& c, int key) { c.update(key); }
+    static hint first_hint(container& c) { return c.end_in_order(); }
+    static hint insert_hint(container& c, const hint& h, int key) { return c.insert_hint(h, key); }
+    static int pop_max(container& c) { return c.pop(); }
+    static int pop_min(container& c) { return c.popleft(); }
+    static int peek_min(const container& c) { return c.min(); }
+
+    static void requeue(container& c, int shift) {
+        int key = c.popleft();
+        c.insert(key + shift);
+    }
+
+    static long iterate(const container& c) {
+        long sum = 0;
+
+        for (auto it = c.begin_in_order(); it != c.end_in_order(); ++it)
+            sum += *it;
+
+        return sum;
+    }
+};
+
+typedef basic_avl_ops<avl_no_stats> avl_ops;
+typedef basic_avl_ops<avl_counting_stats> counted_avl_ops;
+
+/**
+ * @brief Operações de avl_tree com remoção preguiçosa
+ */
+struct lazy_avl_ops : avl_ops {
+    static void remove(container& c, int key) { c.lazy_remove(key); }
+};
+
+/**
+ * @brief Operações de avl_tree como fila de prioridade: os extremos ficam
+ *        nos agregados, e o menor nó volta para a fila sem alocação
+ */
+struct queue_avl_ops {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_strict_balance, avl_bounds<int> > container;
+
+    static void fill(container& c, const std::vector<int>& sorted) {
+        c.build(sorted.begin(), sorted.end());
+    }
+
+    static int peek_min(const container& c) { return c.min(); }
+
+    static void requeue(container& c, int shift) {
+        container::node_type node = c.pop_min();
+        node.value() += shift;
+        c.insert(std::move(node));
+    }
+};
+
+/**
+ * @brief Registra os contadores da instrumentação, quando houver
+ */
+template <class Ops> static void report_stats(benchmark::State&, double) {}
+
+template <> void report_stats<counted_avl_ops>(benchmark::State& state, double ops) {
+    avl_stats_snapshot s = avl_counting_stats::stats();
+
+    state.counters["cmp/op"] = s.comparisons / ops;
+    state.counters["rot/op"] = (s.single_rotations + s.double_rotations) / ops;
+    state.counters["retrace_max"] = s.max_retrace;
+    state.counters["insert_p99_ns"] = (double) s.latency[AVL_INSERT].percentile(99);
+}
+
+/**
+ * @brief Operações equivalentes em std::set
+ */
+struct set_ops {
+    typedef std::set<int> container;
+    typedef container::iterator hint;
+
+    static void fill(container& c, const std::vector<int>& sorted) {
+        c.insert(sorted.begin(), sorted.end());
+    }
+
+    static void insert(container& c, int key) { c.insert(key); }
+    static void remove(container& c, int key) { c.erase(key); }
+    static bool find(const container& c, int key) { return c.count(key) > 0; }
+    static void update(container& c, int key) { c.insert(key); }
+    static hint first_hint(container& c) { return c.end(); }
+    static hint insert_hint(container& c, const hint& h, int key) { return c.emplace_hint(h, key); }
+    static int pop_max(container& c) { int v = *c.rbegin(); c.erase(std::prev(c.end())); return v; }
+    static int pop_min(container& c) { int v = *c.begin(); c.erase(c.begin()); return v; }
+    static int peek_min(const container& c) { return *c.begin(); }
+
+    static void requeue(container& c, int shift) {
+        int key = *c.begin();
+        c.erase(c.begin());
+        c.insert(key + shift);
+    }
+
+    static long iterate(const container& c) {
+        long sum = 0;
+
+        for (auto it = c.begin(); it != c.end(); ++it)
+            sum += *it;
+
+        return sum;
+    }
+};
+
+/**
+ * @brief Operações equivalentes em std::map
+ */
+struct map_ops {
+    typedef std::map<int, int> container;
+
+    static void fill(container& c, const std::vector<int>& sorted) {
+        for (int key : sorted)
+            c.emplace_hint(c.end(), key, key);
+    }
+
+    static void insert(container& c, int key) { c.emplace(key, key); }
+    static void remove(container& c, int key) { c.erase(key); }
+    static bool find(const container& c, int key) { return c.count(key) > 0; }
+    static void update(container& c, int key) { c[key] = key; }
+    static int pop_max(container& c) { int v = c.rbegin()->first; c.erase(std::prev(c.end())); return v; }
+    static int pop_min(container& c) { int v = c.begin()->first; c.erase(c.begin()); return v; }
+
+    static long iterate(const container& c) {
+        long sum = 0;
+
+        for (auto it = c.begin(); it != c.end(); ++it)
+            sum += it->second;
+
+        return sum;
+    }
+};
+
+static std::vector<int> sorted_keys(long n) {
+    std::vector<int> keys(n);
+
+    for (long i = 0; i < n; i++)
+        keys[i] = (int) i;
+
+    return keys;
+}
+
+template <class Ops> static void BM_Insert(benchmark::State& state) {
+    const long n = state.range(0);
+    const distribution d = (distribution) state.range(1);
+    const std::vector<int> keys = unique_keys(d, n);
+
+    double ops = 0, allocs = 0;
+
+    avl_counting_stats::reset();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        typename Ops::container* c = new typename Ops::container();
+
+        // A janela deslizante começa cheia e, a cada chave nova, remove a
+        // mais antiga
+        if (d == SLIDING)
+            Ops::fill(*c, keys);
+
+        unsigned long before = bench_allocations.load();
+        state.ResumeTiming();
+
+        if (d == SLIDING) {
+            for (long i = 0; i < n; i++) {
+                Ops::insert(*c, (int) (n + i));
+                Ops::remove(*c, (int) i);
+            }
+        } else {
+            for (int key : keys)
+                Ops::insert(*c, key);
+        }
+
+        state.PauseTiming();
+        allocs += bench_allocations.load() - before;
+        ops += d == SLIDING ? 2 * n : n;
+        delete c;
+        state.ResumeTiming();
+    }
+
+    report(state, ops, allocs);
+    report_stats<Ops>(state, ops);
+}
+BENCHMARK_TEMPLATE(BM_Insert, avl_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Insert, set_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Insert, map_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Insert, counted_avl_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Insert, lazy_avl_ops)->Apply(sizes_by_distribution);
+
+/**
+ * @brief Insere cada chave a partir da posição da inserção anterior
+ */
+template <class Ops> static void BM_InsertHint(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> keys = unique_keys((distribution) state.range(1), n);
+
+    double ops = 0, allocs = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        typename Ops::container* c = new typename Ops::container();
+        unsigned long before = bench_allocations.load();
+        state.ResumeTiming();
+
+        typename Ops::hint h = Ops::first_hint(*c);
+
+        for (int key : keys)
+            h = Ops::insert_hint(*c, h, key);
+
+        state.PauseTiming();
+        allocs += bench_allocations.load() - before;
+        ops += n;
+        delete c;
+        state.ResumeTiming();
+    }
+
+    report(state, ops, allocs);
+}
+BENCHMARK_TEMPLATE(BM_InsertHint, avl_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_InsertHint, set_ops)->Apply(sizes_by_distribution);
+
+template <class Ops> static void BM_Remove(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> sorted = sorted_keys(n);
+    const std::vector<int> keys = unique_keys((distribution) state.range(1), n);
+
+    double ops = 0, allocs = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        typename Ops::container* c = new typename Ops::container();
+        Ops::fill(*c, sorted);
+        unsigned long before = bench_allocations.load();
+        state.ResumeTiming();
+
+        for (int key : keys)
+            Ops::remove(*c, key);
+
+        state.PauseTiming();
+        allocs += bench_allocations.load() - before;
+        ops += n;
+        delete c;
+        state.ResumeTiming();
+    }
+
+    report(state, ops, allocs);
+}
+BENCHMARK_TEMPLATE(BM_Remove, avl_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Remove, set_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Remove, lazy_avl_ops)->Apply(sizes_by_distribution);
+
+template <class Ops> static void BM_Find(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> keys = access_keys((distribution) state.range(1), n);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted_keys(n));
+
+    unsigned long before = bench_allocations.load();
+
+    for (auto _ : state)
+        for (int key : keys)
+            benchmark::DoNotOptimize(Ops::find(c, key));
+
+    report(state, (double) state.iterations() * n, bench_allocations.load() - before);
+}
+BENCHMARK_TEMPLATE(BM_Find, avl_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Find, set_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Find, counted_avl_ops)->Apply(sizes_by_distribution);
+
+template <class Ops> static void BM_Update(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> keys = access_keys((distribution) state.range(1), n);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted_keys(n));
+
+    unsigned long before = bench_allocations.load();
+
+    for (auto _ : state)
+        for (int key : keys)
+            Ops::update(c, key);
+
+    report(state, (double) state.iterations() * n, bench_allocations.load() - before);
+}
+BENCHMARK_TEMPLATE(BM_Update, avl_ops)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Update, map_ops)->Apply(sizes_by_distribution);
+
+template <class Ops, bool Max> static void BM_Pop(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> sorted = sorted_keys(n);
+
+    double ops = 0, allocs = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        typename Ops::container* c = new typename Ops::container();
+        Ops::fill(*c, sorted);
+        unsigned long before = bench_allocations.load();
+        state.ResumeTiming();
+
+        for (long i = 0; i < n; i++)
+            benchmark::DoNotOptimize(Max ? Ops::pop_max(*c) : Ops::pop_min(*c));
+
+        state.PauseTiming();
+        allocs += bench_allocations.load() - before;
+        ops += n;
+        delete c;
+        state.ResumeTiming();
+    }
+
+    report(state, ops, allocs);
+}
+BENCHMARK_TEMPLATE(BM_Pop, avl_ops, true)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Pop, avl_ops, false)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Pop, set_ops, true)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Pop, set_ops, false)->Apply(sizes_only);
+
+/**
+ * @brief Fila de prazos: lê o menor prazo e o reagenda para depois do maior
+ */
+template <class Ops> static void BM_Requeue(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> sorted = sorted_keys(n);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted);
+
+    double ops = 0;
+    unsigned long before = bench_allocations.load();
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Ops::peek_min(c));
+        Ops::requeue(c, (int) n);
+        ops++;
+    }
+
+    report(state, ops, (double) (bench_allocations.load() - before));
+}
+BENCHMARK_TEMPLATE(BM_Requeue, avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Requeue, queue_avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Requeue, set_ops)->Apply(sizes_only);
+
+template <class Ops> static void BM_PeekMin(benchmark::State& state) {
+    const long n = state.range(0);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted_keys(n));
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Ops::peek_min(c));
+
+    report(state, (double) state.iterations(), 0);
+}
+BENCHMARK_TEMPLATE(BM_PeekMin, avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_PeekMin, queue_avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_PeekMin, set_ops)->Apply(sizes_only);
+
+template <class Ops> static void BM_IterateInOrder(benchmark::State& state) {
+    const long n = state.range(0);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted_keys(n));
+
+    unsigned long before = bench_allocations.load();
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Ops::iterate(c));
+
+    report(state, (double) state.iterations() * n, bench_allocations.load() - before);
+}
+BENCHMARK_TEMPLATE(BM_IterateInOrder, avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_IterateInOrder, set_ops)->Apply(sizes_only);
+
+template <class Ops> static void BM_Copy(benchmark::State& state) {
+    const long n = state.range(0);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted_keys(n));
+
+    double allocs = 0;
+
+    for (auto _ : state) {
+        unsigned long before = bench_allocations.load();
+        typename Ops::container* copy = new typename Ops::container(c);
+        allocs += bench_allocations.load() - before;
+
+        state.PauseTiming();
+        delete copy;
+        state.ResumeTiming();
+    }
+
+    report(state, (double) state.iterations() * n, allocs);
+}
+BENCHMARK_TEMPLATE(BM_Copy, avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Copy, set_ops)->Apply(sizes_only);
+
+// Cópia seguida de uma escrita: com cópia na escrita, só o caminho alterado
+// é alocado
+template <class Ops> static void BM_CopyThenWrite(benchmark::State& state) {
+    const long n = state.range(0);
+
+    typename Ops::container c;
+    Ops::fill(c, sorted_keys(n));
+
+    double allocs = 0;
+
+    for (auto _ : state) {
+        unsigned long before = bench_allocations.load();
+        typename Ops::container* copy = new typename Ops::container(c);
+        Ops::insert(*copy, (int) n);
+        allocs += bench_allocations.load() - before;
+
+        state.PauseTiming();
+        delete copy;
+        state.ResumeTiming();
+    }
+
+    report(state, (double) state.iterations(), allocs);
+}
+BENCHMARK_TEMPLATE(BM_CopyThenWrite, avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_CopyThenWrite, set_ops)->Apply(sizes_only);
+
+template <class Ops> static void BM_Clear(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> sorted = sorted_keys(n);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        typename Ops::container c;
+        Ops::fill(c, sorted);
+        state.ResumeTiming();
+
+        c.clear();
+    }
+
+    report(state, (double) state.iterations() * n, 0);
+}
+BENCHMARK_TEMPLATE(BM_Clear, avl_ops)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_Clear, set_ops)->Apply(sizes_only);
+
+/**
+ * @brief Esvaziamento adiado: o `clear` custa O(1), e cada operação mede uma
+ *        fatia de `reclaim`, que é a maior parada de quem a chamar
+ */
+static void BM_ReclaimSlice(benchmark::State& state) {
+    const long n = state.range(0);
+    const std::vector<int> sorted = sorted_keys(n);
+
+    avl_ops::container c;
+    avl_ops::container::reclaimer garbage;
+
+    for (auto _ : state) {
+        if (garbage.empty()) {
+            state.PauseTiming();
+            avl_ops::fill(c, sorted);
+            c.clear(garbage);
+            state.ResumeTiming();
+        }
+
+        garbage.reclaim(1024);
+    }
+
+    report(state, (double) state.iterations(), 0);
+}
+BENCHMARK(BM_ReclaimSlice)->Apply(sizes_only);
+
+static void BM_BuildSorted(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    for (auto _ : state) {
+        avl_tree<int> t;
+        t.build(v.begin(), v.end());
+        benchmark::DoNotOptimize(t.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildSorted)->Range(1 << 10, 1 << 20);
+
+static void BM_BuildParallel(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    for (auto _ : state) {
+        avl_tree<int> t;
+        t.build_parallel(v.begin(), v.end(), (unsigned) state.range(1));
+        benchmark::DoNotOptimize(t.size());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BuildParallel)
+    ->ArgNames({ "n", "threads" })
+    ->ArgsProduct({ { 1 << 20 }, { 1, 2, 4, 8 } })
+    ->UseRealTime();
+
+static void BM_ParallelReduce(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    for (auto _ : state) {
+        long sum = t.parallel_reduce(0l,
+            [](int x) { return (long) x; },
+            [](long a, long b) { return a + b; },
+            (unsigned) state.range(1));
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParallelReduce)
+    ->ArgNames({ "n", "threads" })
+    ->ArgsProduct({ { 1 << 20 }, { 1, 2, 4, 8 } })
+    ->UseRealTime();
+
+static void BM_LoadText(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    std::ostringstream out;
+    out << t;
+    const std::string text = out.str();
+
+    for (auto _ : state) {
+        std::istringstream in(text);
+        avl_tree<int> u;
+        in >> u;
+        benchmark::DoNotOptimize(u.size());
+    }
+
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadText)->Range(1 << 10, 1 << 20);
+
+static void BM_GraphvizExport(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    for (auto _ : state) {
+        std::ostringstream out;
+        t.gv_save(out);
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GraphvizExport)->Range(1 << 10, 1 << 20);
+
+static void BM_Dump(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    for (auto _ : state) {
+        std::ostringstream out;
+        t.dump(out, (avl_tree<int>::traversal) state.range(1));
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Dump)->ArgsProduct({ { 1 << 20 }, { 0, 1, 2, 3 } });
+
+static void BM_WriteText(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    for (auto _ : state) {
+        std::ostringstream out;
+        out << t;
+        benchmark::DoNotOptimize(out.tellp());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WriteText)->Range(1 << 10, 1 << 20);
+
+static void BM_LevelIterator(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    for (auto _ : state) {
+        long sum = 0;
+
+        for (auto it = t.begin_by_level(); it != t.end_by_level(); ++it)
+            sum += *it;
+
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LevelIterator)->Range(1 << 10, 1 << 20);
+
+static void BM_ForEachLevel(benchmark::State& state) {
+    std::vector<int> v;
+    for (int i = 0; i < state.range(0); i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    for (auto _ : state) {
+        long sum = 0;
+        t.for_each_level([&](int data, int) { sum += data; });
+        benchmark::DoNotOptimize(sum);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ForEachLevel)->Range(1 << 10, 1 << 20);
+
+/**
+ * @brief Insere n chaves e remove metade delas, com uma política de
+ *        balanceamento, e conta as rotações e a altura alcançada
+ */
+template <class Balance> static void BM_Balance(benchmark::State& state) {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_counting_stats, Balance> tree;
+
+    const long n = state.range(0);
+    const std::vector<int> keys = unique_keys((distribution) state.range(1), n);
+    const std::vector<int> victims = unique_keys(UNIFORM, n);
+
+    double ops = 0, allocs = 0, height = 0;
+
+    tree::reset_stats();
+
+    for (auto _ : state) {
+        tree* t = new tree();
+        unsigned long before = bench_allocations.load();
+
+        for (int key : keys)
+            t->insert(key);
+
+        height = t->height();
+
+        for (long i = 0; i < n; i += 2)
+            t->remove(victims[i]);
+
+        allocs += bench_allocations.load() - before;
+        ops += n + (n + 1) / 2;
+
+        state.PauseTiming();
+        delete t;
+        state.ResumeTiming();
+    }
+
+    avl_stats_snapshot s = tree::stats();
+
+    report(state, ops, allocs);
+    state.counters["rot/op"] = (s.single_rotations + s.double_rotations) / ops;
+    state.counters["retrace/op"] = s.retraces / ops;
+    state.counters["height"] = height;
+}
+BENCHMARK_TEMPLATE(BM_Balance, avl_strict_balance)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Balance, avl_relaxed_balance<2>)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Balance, avl_relaxed_balance<4>)->Apply(sizes_by_distribution);
+BENCHMARK_TEMPLATE(BM_Balance, avl_weak_balance)->Apply(sizes_by_distribution);
+
+/**
+ * @brief Insere chaves de texto crescentes, com prefixo comum longo, com e
+ *        sem a posição da inserção anterior
+ */
+template <bool Hinted> static void BM_InsertStrings(benchmark::State& state) {
+    const long n = state.range(0);
+    std::vector<std::string> keys(n);
+
+    for (long i = 0; i < n; i++) {
+        char buf[64];
+        snprintf(buf, sizeof buf, "sensors/building-7/floor-3/temperature/%010ld", i);
+        keys[i] = buf;
+    }
+
+    for (auto _ : state) {
+        avl_tree<std::string> t;
+        auto h = t.end_in_order();
+
+        for (const std::string& key : keys) {
+            if (Hinted)
+                h = t.insert_hint(h, key);
+            else
+                t.insert(key);
+        }
+
+        state.PauseTiming();
+        t.clear();
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK_TEMPLATE(BM_InsertStrings, false)->Range(1 << 10, 1 << 17);
+BENCHMARK_TEMPLATE(BM_InsertStrings, true)->Range(1 << 10, 1 << 17);
+
+/**
+ * @brief Soma as chaves de intervalos aleatórios, pelo agregado da árvore
+ *        ou percorrendo o intervalo
+ */
+/**
+ * @brief Expiração de chaves por tempo: a cada iteração, as `width` chaves
+ *        mais antigas saem e o mesmo número de chaves novas entra
+ */
+template <bool Ranged> static void BM_EraseRange(benchmark::State& state) {
+    const long n = state.range(0), width = state.range(1);
+
+    avl_tree<int> t;
+    std::vector<int> v = sorted_keys(n);
+    t.build(v.begin(), v.end());
+
+    int oldest = 0, next = (int) n;
+
+    for (auto _ : state) {
+        if (Ranged) {
+            t.erase_range(oldest, oldest + (int) width - 1);
+        } else {
+            for (int k = oldest; k < oldest + width; k++)
+                t.remove(k);
+        }
+
+        oldest += (int) width;
+
+        state.PauseTiming();
+        for (long i = 0; i < width; i++)
+            t.insert(next++);
+        state.ResumeTiming();
+    }
+
+    state.SetItemsProcessed(state.iterations() * width);
+}
+BENCHMARK_TEMPLATE(BM_EraseRange, true)->ArgsProduct({ { 1 << 20 }, { 1000, 100000 } });
+BENCHMARK_TEMPLATE(BM_EraseRange, false)->ArgsProduct({ { 1 << 20 }, { 1000, 100000 } });
+
+/**
+ * @brief Move elementos entre duas árvores, como no rebalanceamento de
+ *        partições
+ */
+template <bool Handles> static void BM_MoveBetweenTrees(benchmark::State& state) {
+    const long n = state.range(0);
+
+    avl_tree<std::string> a, b;
+    std::vector<std::string> keys;
+
+    for (long i = 0; i < n; i++) {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "partition-key-%08ld", i);
+        keys.push_back(buf);
+    }
+
+    a.build(keys.begin(), keys.end());
+
+    std::mt19937 rng(5);
+    unsigned long before = bench_allocations.load();
+
+    for (auto _ : state) {
+        const std::string& key = keys[rng() % n];
+        avl_tree<std::string>& from = a.includes(key) ? a : b;
+        avl_tree<std::string>& to = &from == &a ? b : a;
+
+        if (Handles) {
+            to.insert(from.extract(key));
+        } else {
+            from.remove(key);
+            to.insert(key);
+        }
+    }
+
+    report(state, (double) state.iterations(), (double) (bench_allocations.load() - before));
+}
+BENCHMARK_TEMPLATE(BM_MoveBetweenTrees, true)->Arg(1 << 10)->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_MoveBetweenTrees, false)->Arg(1 << 10)->Arg(1 << 20);
+
+template <bool Augmented> static void BM_RangeSum(benchmark::State& state) {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_strict_balance, avl_sum<long> > tree;
+
+    const long n = state.range(0), width = state.range(1);
+
+    tree t;
+    std::vector<int> v = sorted_keys(n);
+    t.build(v.begin(), v.end());
+
+    std::mt19937 rng(3);
+    long checksum = 0;
+
+    for (auto _ : state) {
+        int lo = (int) (rng() % n), hi = lo + (int) width - 1;
+
+        if (Augmented) {
+            checksum += t.aggregate(lo, hi);
+        } else {
+            long sum = 0;
+
+            // O iterador não tem busca: percorre desde o começo
+            for (auto it = t.begin_in_order(); it != t.end_in_order() && *it <= hi; ++it)
+                if (*it >= lo)
+                    sum += *it;
+
+            checksum += sum;
+        }
+    }
+
+    benchmark::DoNotOptimize(checksum);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_RangeSum, true)->ArgsProduct({ { 1 << 10, 1 << 20 }, { 100, 10000 } });
+BENCHMARK_TEMPLATE(BM_RangeSum, false)->ArgsProduct({ { 1 << 10, 1 << 20 }, { 100, 10000 } });
@@ -0,0 +1,55 @@
+#include <avl_tree_prefix.hpp>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include "bench_util.hpp"
+
+/**
+ * @brief Gera n caminhos distintos, já sem o começo comum, longos demais
+ *        para caber na própria string
+ */
+static std::vector<std::string> random_paths(long n) {
+    static const char hex[] = "0123456789abcdef";
+
+    std::mt19937 rng(42);
+    std::vector<std::string> v;
+
+    for (long i = 0; i < n; i++) {
+        std::string s;
+
+        for (int j = 0; j < 16; j++)
+            s += hex[rng() % 16];
+
+        v.push_back(s + "/static/assets/index.html");
+    }
+
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+
+    return v;
+}
+
+/**
+ * @brief Busca de chaves de texto em ordem aleatória, com ou sem o prefixo
+ *        guardado nos nós
+ */
+template <class Compare> static void BM_FindString(benchmark::State& state) {
+    const long n = state.range(0);
+    std::vector<std::string> keys = random_paths(n);
+
+    avl_tree<std::string, Compare> t;
+    t.build(keys.begin(), keys.end());
+
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+
+    for (auto _ : state)
+        for (const std::string& key : keys)
+            benchmark::DoNotOptimize(t.includes(key));
+
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+BENCHMARK_TEMPLATE(BM_FindString, std::less<std::string>)->Apply(sizes_only);
+BENCHMARK_TEMPLATE(BM_FindString, avl_prefix_less<>)->Apply(sizes_only);
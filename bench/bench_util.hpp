@@ -0,0 +1,86 @@
+/**
+ * @brief Utilitários compartilhados pelos benchmarks
+ *
+ * @file bench_util.hpp
+ */
+
+#ifndef BENCH_UTIL_HPP
+#define BENCH_UTIL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <benchmark/benchmark.h>
+
+#include "workload.hpp"
+
+//! Número de alocações feitas pelo processo (definido em avl_tree_bench.cpp)
+extern std::atomic<unsigned long> bench_allocations;
+
+/**
+ * @brief Obtém o pico de memória residente do processo, em MiB
+ */
+inline double peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss / 1024.0;
+}
+
+/**
+ * @brief Registra os contadores padrão de um benchmark
+ *
+ * @param state Estado do benchmark
+ * @param ops Número total de operações medidas
+ * @param allocs Número de alocações feitas nas operações medidas
+ */
+inline void report(benchmark::State& state, double ops, double allocs) {
+    using benchmark::Counter;
+
+    state.SetItemsProcessed((int64_t) ops);
+    state.counters["time/op"] = Counter(ops, Counter::kIsRate | Counter::kInvert);
+    state.counters["allocs/op"] = ops > 0 ? allocs / ops : 0;
+    state.counters["peak_rss_MB"] = peak_rss_mb();
+}
+
+/**
+ * @brief Tamanhos de árvore medidos: de 1K até AVL_BENCH_MAX_N elementos
+ *        (1M por padrão, até 100M), em potências de 10
+ */
+inline std::vector<int64_t> bench_sizes() {
+    const char* env = std::getenv("AVL_BENCH_MAX_N");
+    int64_t max = env ? std::atoll(env) : 1000000;
+    std::vector<int64_t> sizes;
+
+    for (int64_t n = 1000; n <= max && n <= 100000000; n *= 10)
+        sizes.push_back(n);
+
+    return sizes;
+}
+
+/**
+ * @brief Registra um benchmark para todos os tamanhos e distribuições
+ */
+inline void sizes_by_distribution(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "n", "dist" });
+
+    for (int64_t n : bench_sizes())
+        for (int d = SEQUENTIAL; d <= SLIDING; d++)
+            b->Args({ n, d });
+}
+
+/**
+ * @brief Registra um benchmark para todos os tamanhos
+ */
+inline void sizes_only(benchmark::internal::Benchmark* b) {
+    b->ArgNames({ "n" });
+
+    for (int64_t n : bench_sizes())
+        b->Args({ n });
+}
+
+#endif // BENCH_UTIL_HPP
@@ -0,0 +1,43 @@
+#include <durable_avl_tree.hpp>
+#include <benchmark/benchmark.h>
+
+static void BM_InsertInMemory(benchmark::State& state) {
+    int i = 0;
+    avl_tree<int> t;
+
+    for (auto _ : state)
+        t.insert(i++);
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InsertInMemory);
+
+static void BM_InsertDurable(benchmark::State& state) {
+    const std::string path = "durable_bench";
+    std::remove((path + ".wal").c_str());
+    std::remove((path + ".snapshot").c_str());
+
+    durability_options opts;
+    opts.group_size = state.range(0);
+    opts.fsync_interval = state.range(1);
+
+    int i = 0;
+
+    {
+        durable_avl_tree<int> t(path, opts);
+
+        for (auto _ : state)
+            t.insert(i++);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+
+    std::remove((path + ".wal").c_str());
+    std::remove((path + ".snapshot").c_str());
+}
+BENCHMARK(BM_InsertDurable)
+    ->Args({ 1, 1 })
+    ->Args({ 64, 1 })
+    ->Args({ 1024, 1 })
+    ->Args({ 1024, 16 })
+    ->Args({ 1024, 0 });
@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <avl_tree.hpp>
+#include <avl_tree_augment.hpp>
+
+#include "workload.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock clock_type;
+
+/**
+ * @brief Tipos de operação de uma carga
+ */
+enum op_kind {
+    OP_INSERT,
+    OP_REMOVE,
+    OP_FIND,
+    OP_RANGE,       //! Conta as chaves de um intervalo
+    OP_KINDS
+};
+
+static const char* const op_names[OP_KINDS] = { "insert", "remove", "find", "range" };
+
+/**
+ * @brief Operação de uma carga
+ */
+struct operation {
+    op_kind kind;
+    int a;          //! Chave, ou início do intervalo
+    int b;          //! Fim do intervalo, inclusive
+};
+
+/**
+ * @brief Predicado que aceita todas as chaves, para contar intervalos
+ */
+struct any_key {
+    bool operator()(int) const { return true; }
+};
+
+typedef avl_tree<
+    int, less<int>, equal_to<int>,
+    avl_no_stats, avl_strict_balance, avl_count_if<int, any_key>
+> tree_t;
+
+/**
+ * @brief Opções do gerador
+ */
+struct options {
+    double rate = 0;            //! Operações por segundo; 0 é laço fechado
+    int threads = 1;
+    long ops = 1000000;         //! Operações da carga sintética
+    int keys = 1 << 20;         //! Chaves da carga sintética, em [0, keys)
+    int mix[OP_KINDS] = { 25, 25, 45, 5 };
+    bool zipf = false;          //! Chaves concentradas em regiões quentes
+    int span = 100;             //! Largura dos intervalos sintéticos
+    double interval = 1;        //! Segundos entre relatos de vazão
+    vector<string> traces;
+    string output;              //! Arquivo que recebe a carga sintética
+};
+
+/**
+ * @brief Lê um inteiro não negativo de uma linha de carga
+ */
+static bool read_key(const char* & p, int& value) {
+    while (*p == ' ' || *p == '\t')
+        p++;
+
+    if (!isdigit((unsigned char) *p))
+        return false;
+
+    long long v = 0;
+
+    for (; isdigit((unsigned char) *p); p++) {
+        v = v * 10 + (*p - '0');
+
+        if (v > 2147483647)
+            return false;
+    }
+
+    value = (int) v;
+    return true;
+}
+
+/**
+ * @brief Lê uma carga gravada
+ *
+ * Cada linha tem uma operação: `i N`, `r N` e `f N` (ou `insert`, `remove`
+ * e `find`), ou `range A B`. Os outros comandos do `avl_tree -b` são
+ * ignorados, então os mesmos arquivos servem aos dois programas.
+ *
+ * @param in Arquivo da carga
+ * @param ops Recebe as operações
+ * @return long Número de linhas ignoradas
+ */
+static long read_trace(istream& in, vector<operation>& ops) {
+    string line;
+    long skipped = 0;
+
+    while (getline(in, line)) {
+        const char* p = line.c_str();
+        string word;
+
+        while (*p == ' ' || *p == '\t')
+            p++;
+
+        if (*p == '\0' || *p == '#' || *p == '\r')
+            continue;
+
+        for (; isalpha((unsigned char) *p); p++)
+            word += (char) tolower((unsigned char) *p);
+
+        operation op;
+        bool ok = read_key(p, op.a);
+        op.b = op.a;
+
+        if (word == "i" || word == "insert")
+            op.kind = OP_INSERT;
+        else if (word == "r" || word == "remove")
+            op.kind = OP_REMOVE;
+        else if (word == "f" || word == "find")
+            op.kind = OP_FIND;
+        else if (word == "range")
+            op.kind = OP_RANGE, ok = ok && read_key(p, op.b) && op.a <= op.b;
+        else
+            ok = false;
+
+        if (ok)
+            ops.push_back(op);
+        else
+            skipped++;
+    }
+
+    return skipped;
+}
+
+/**
+ * @brief Grava uma carga no formato lido por `read_trace`
+ */
+static void write_trace(ostream& out, const vector<operation>& ops) {
+    for (const operation& op : ops) {
+        if (op.kind == OP_RANGE)
+            out << "range " << op.a << ' ' << op.b << '\n';
+        else
+            out << "irf"[op.kind] << ' ' << op.a << '\n';
+    }
+}
+
+/**
+ * @brief Gera uma carga sintética com a mistura de operações pedida
+ */
+static vector<operation> synthetic(const options& opts) {
+    vector<operation> ops(opts.ops);
+    mt19937 rng(42);
+    zipf_generator zipf(opts.keys);
+    int total = 0;
+
+    for (int k = 0; k < OP_KINDS; k++)
+        total += opts.mix[k];
+
+    for (operation& op : ops) {
+        int pick = (int) (rng() % total), k = 0;
+
+        while (pick >= opts.mix[k])
+            pick -= opts.mix[k++];
+
+        // Espalha as chaves quentes pela árvore, como em `access_keys`
+        long key = opts.zipf ? (zipf() * 2654435761ul) % opts.keys : rng() % opts.keys;
+
+        op.kind = (op_kind) k;
+        op.a = (int) key;
+        op.b = (int) min<long>(key + opts.span - 1, 2147483647);
+    }
+
+    return ops;
+}
+
+/**
+ * @brief Resultado de uma thread
+ */
+struct worker_result {
+    vector<long> latency[OP_KINDS];     //! Latências, em nanossegundos
+    long failed[OP_KINDS] = {};         //! Operações que lançaram erro
+};
+
+/**
+ * @brief Estado compartilhado pelas threads
+ */
+struct shared_state {
+    tree_t tree;
+    mutex lock;                         //! A árvore aceita uma escrita por vez
+    atomic<long> done{ 0 };             //! Operações concluídas
+    clock_type::time_point start;
+};
+
+/**
+ * @brief Executa uma operação na árvore
+ *
+ * @return bool Se a operação foi concluída sem erro
+ */
+static bool apply(tree_t& tree, const operation& op) {
+    try {
+        switch (op.kind) {
+        case OP_INSERT:
+            tree.insert(op.a);
+            break;
+
+        case OP_REMOVE:
+            tree.remove(op.a);
+            break;
+
+        case OP_FIND:
+            return tree.includes(op.a);
+
+        default:
+            tree.aggregate(op.a, op.b);
+            break;
+        }
+    } catch (const char*) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Executa as operações `first`, `first + step`, ... da carga
+ *
+ * Em laço aberto, a operação i é agendada para `start + i / rate`,
+ * independentemente de quando as anteriores terminaram, e a latência é
+ * medida a partir do horário agendado. Assim, o tempo que uma operação
+ * passa esperando uma anterior lenta entra na latência dela, em vez de
+ * atrasar o envio das próximas (a "omissão coordenada" de um laço fechado).
+ */
+static void work(
+    shared_state& state, const vector<operation>& ops, const options& opts,
+    size_t first, size_t step, worker_result& result
+) {
+    for (size_t i = first; i < ops.size(); i += step) {
+        clock_type::time_point due = clock_type::now();
+
+        if (opts.rate > 0) {
+            due = state.start + chrono::duration_cast<clock_type::duration>(
+                chrono::duration<double>(i / opts.rate));
+
+            // Dorme até perto do horário e espera o resto ativamente
+            if (due - clock_type::now() > chrono::microseconds(200))
+                this_thread::sleep_until(due - chrono::microseconds(100));
+
+            while (clock_type::now() < due)
+                this_thread::yield();
+        }
+
+        bool ok;
+
+        {
+            lock_guard<mutex> guard(state.lock);
+            ok = apply(state.tree, ops[i]);
+        }
+
+        long ns = (long) chrono::duration_cast<chrono::nanoseconds>(
+            clock_type::now() - due).count();
+
+        result.latency[ops[i].kind].push_back(ns);
+
+        // Buscas que não encontram a chave não são falhas
+        if (!ok && ops[i].kind != OP_FIND)
+            result.failed[ops[i].kind]++;
+
+        state.done.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Obtém um percentil, em microssegundos, de latências já ordenadas
+ */
+static double percentile(const vector<long>& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+
+    size_t i = (size_t) (p / 100 * (sorted.size() - 1) + 0.5);
+    return sorted[i] / 1000.0;
+}
+
+/**
+ * @brief Lê as opções da linha de comando
+ *
+ * @return bool Se as opções são válidas
+ */
+static bool parse_options(int argc, char** argv, options& opts) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "-r" && has_value)
+            opts.rate = atof(argv[++i]);
+        else if (arg == "-t" && has_value)
+            opts.threads = atoi(argv[++i]);
+        else if (arg == "-n" && has_value)
+            opts.ops = atol(argv[++i]);
+        else if (arg == "-k" && has_value)
+            opts.keys = atoi(argv[++i]);
+        else if (arg == "-s" && has_value)
+            opts.span = atoi(argv[++i]);
+        else if (arg == "-i" && has_value)
+            opts.interval = atof(argv[++i]);
+        else if (arg == "-o" && has_value)
+            opts.output = argv[++i];
+        else if (arg == "-z")
+            opts.zipf = true;
+        else if (arg == "-m" && has_value) {
+            // Porcentagens de insert:remove:find:range
+            const char* p = argv[++i];
+            int total = 0;
+
+            for (int k = 0; k < OP_KINDS; k++) {
+                if (!read_key(p, opts.mix[k]) || (k + 1 < OP_KINDS && *p++ != ':'))
+                    return false;
+
+                total += opts.mix[k];
+            }
+
+            if (*p != '\0' || total == 0)
+                return false;
+
+        } else if (arg[0] != '-' || arg == "-")
+            opts.traces.push_back(arg);
+        else
+            return false;
+    }
+
+    return opts.rate >= 0 && opts.threads > 0 && opts.ops > 0 && opts.keys > 0
+        && opts.span > 0 && opts.interval > 0;
+}
+
+int main(int argc, char** argv) {
+    options opts;
+
+    if (!parse_options(argc, argv, opts)) {
+        cerr << "Usage: " << argv[0] << " [-r ops/s] [-t threads] [-i seconds]\n"
+             << "       [-n ops] [-k keys] [-m insert:remove:find:range] [-s span] [-z]\n"
+             << "       [-o file] [trace...]" << endl;
+        return 1;
+    }
+
+    ios::sync_with_stdio(false);
+
+    vector<operation> ops;
+    shared_state state;
+
+    if (opts.traces.empty()) {
+        ops = synthetic(opts);
+
+        // Metade das chaves já está na árvore, então inserções e remoções
+        // falham na mesma proporção
+        vector<int> keys = unique_keys(UNIFORM, opts.keys);
+        keys.resize(opts.keys / 2);
+        sort(keys.begin(), keys.end());
+        state.tree.build(keys.begin(), keys.end());
+
+    } else {
+        long skipped = 0;
+
+        for (const string& file : opts.traces) {
+            if (file == "-") {
+                skipped += read_trace(cin, ops);
+                continue;
+            }
+
+            ifstream f(file);
+
+            if (!f) {
+                cerr << "Err: Can't open `" << file << "'" << endl;
+                return 1;
+            }
+
+            skipped += read_trace(f, ops);
+        }
+
+        if (skipped)
+            cerr << "Skipped " << skipped << " lines that are not operations" << endl;
+    }
+
+    if (!opts.output.empty()) {
+        ofstream out(opts.output);
+        write_trace(out, ops);
+    }
+
+    if (ops.empty()) {
+        cerr << "Err: Empty trace" << endl;
+        return 1;
+    }
+
+    vector<worker_result> results(opts.threads);
+    vector<thread> workers;
+
+    state.start = clock_type::now();
+
+    for (int w = 0; w < opts.threads; w++)
+        workers.push_back(thread(work, ref(state), cref(ops), cref(opts),
+            (size_t) w, (size_t) opts.threads, ref(results[w])));
+
+    // Vazão ao longo do tempo
+    cout << fixed << setprecision(1);
+
+    long last = 0;
+    clock_type::time_point tick = state.start;
+
+    while (last < (long) ops.size()) {
+        tick += chrono::duration_cast<clock_type::duration>(
+            chrono::duration<double>(opts.interval));
+
+        long done;
+
+        while ((done = state.done.load()) < (long) ops.size() && clock_type::now() < tick)
+            this_thread::sleep_for(chrono::milliseconds(1));
+
+        double elapsed = chrono::duration<double>(clock_type::now() - state.start).count();
+        cout << "t=" << elapsed << "s\t" << (done - last) / opts.interval << " ops/s\n";
+        cout.flush();
+
+        last = done;
+    }
+
+    for (thread& w : workers)
+        w.join();
+
+    double elapsed = chrono::duration<double>(clock_type::now() - state.start).count();
+
+    cout << "\n" << left << setw(8) << "op" << right
+         << setw(10) << "count" << setw(10) << "failed"
+         << setw(12) << "p50 (us)" << setw(12) << "p99 (us)"
+         << setw(12) << "p99.9 (us)" << setw(12) << "max (us)" << "\n";
+
+    for (int k = 0; k < OP_KINDS; k++) {
+        vector<long> all;
+        long failed = 0;
+
+        for (const worker_result& r : results) {
+            all.insert(all.end(), r.latency[k].begin(), r.latency[k].end());
+            failed += r.failed[k];
+        }
+
+        if (all.empty())
+            continue;
+
+        sort(all.begin(), all.end());
+
+        cout << left << setw(8) << op_names[k] << right
+             << setw(10) << all.size() << setw(10) << failed
+             << setw(12) << percentile(all, 50) << setw(12) << percentile(all, 99)
+             << setw(12) << percentile(all, 99.9) << setw(12) << all.back() / 1000.0 << "\n";
+    }
+
+    cout << "\n" << ops.size() << " ops in " << setprecision(3) << elapsed << " s, "
+         << setprecision(0) << ops.size() / elapsed << " ops/s";
+
+    if (opts.rate > 0)
+        cout << " (target " << opts.rate << " ops/s)";
+
+    cout << ", " << state.tree.size() << " elements" << endl;
+
+    return 0;
+}
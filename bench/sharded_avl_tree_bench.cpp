@@ -0,0 +1,107 @@
+#include <sharded_avl_tree.hpp>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Uma única avl_tree protegida por uma trava, como é usada hoje
+ */
+class locked_avl_tree {
+private:
+    std::mutex lock;
+    avl_tree<int> tree;
+
+public:
+    void insert(int x) {
+        std::lock_guard<std::mutex> guard(lock);
+        tree.insert(x);
+    }
+
+    void remove(int x) {
+        std::lock_guard<std::mutex> guard(lock);
+        tree.remove(x);
+    }
+
+    bool includes(int x) {
+        std::lock_guard<std::mutex> guard(lock);
+        return tree.includes(x);
+    }
+};
+
+static const int KEYS = 1 << 20;
+
+/**
+ * @brief Cria a árvore única com trava; o número de shards é ignorado
+ */
+static locked_avl_tree* make_tree(locked_avl_tree*, int) {
+    return new locked_avl_tree();
+}
+
+/**
+ * @brief Cria a árvore particionada já dividida em intervalos iguais
+ *
+ * @param shards Número de shards, ou 1 para começar com um shard só
+ */
+static sharded_avl_tree<int>* make_tree(sharded_avl_tree<int>*, int shards) {
+    std::vector<int> bounds;
+
+    for (int i = 1; i < shards; i++)
+        bounds.push_back((int) ((long long) KEYS * i / shards));
+
+    return new sharded_avl_tree<int>(bounds);
+}
+
+/**
+ * @brief Carga mista, com metade de buscas e metade de escritas, de várias
+ *        threads ao mesmo tempo
+ *
+ * Cada thread escreve só as chaves congruentes ao seu número, então as
+ * escritas nunca falham. O argumento é o número de shards por thread com
+ * que a árvore começa; com 0, ela começa com um shard só, como referência.
+ */
+template <class Tree> static void BM_MixedThreads(benchmark::State& state) {
+    static Tree* t;
+
+    const int threads = state.threads(), me = state.thread_index();
+
+    if (me == 0) {
+        t = make_tree((Tree*) nullptr, std::max(1, (int) state.range(0) * threads));
+
+        for (int i = 0; i < KEYS; i += 2)
+            t->insert(i);
+    }
+
+    std::mt19937 rng(me + 1);
+    std::vector<char> present(KEYS / threads + 1, 0);
+
+    // Estado inicial das chaves desta thread
+    for (int i = 0; i < (int) present.size(); i++)
+        present[i] = (i * threads + me) % 2 == 0;
+
+    for (auto _ : state) {
+        int i = (int) (rng() % (KEYS / threads));
+        int key = i * threads + me;
+
+        if (rng() % 2) {
+            benchmark::DoNotOptimize(t->includes(key));
+        } else if (present[i]) {
+            t->remove(key);
+            present[i] = 0;
+        } else {
+            t->insert(key);
+            present[i] = 1;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+
+    if (me == 0)
+        delete t;
+}
+BENCHMARK_TEMPLATE(BM_MixedThreads, locked_avl_tree)
+    ->ArgName("shards_per_thread")->Arg(0)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_MixedThreads, sharded_avl_tree<int>)
+    ->ArgName("shards_per_thread")->Arg(0)->Arg(4)->ThreadRange(1, 8)->UseRealTime();
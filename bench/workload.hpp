@@ -0,0 +1,138 @@
+/**
+ * @brief Geradores de chaves das cargas de trabalho, sem dependência do
+ *        Google Benchmark
+ *
+ * @file workload.hpp
+ */
+
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Distribuições de chaves das cargas de trabalho
+ */
+enum distribution {
+    SEQUENTIAL,     //! Chaves em ordem crescente
+    UNIFORM,        //! Chaves em ordem aleatória
+    ZIPFIAN,        //! Chaves concentradas em regiões quentes
+    SLIDING         //! Janela deslizante: novas chaves entram, antigas saem
+};
+
+/**
+ * @brief Gerador de números com distribuição de Zipf em [0, n), no estilo
+ *        do YCSB (Gray et al., "Quickly generating billion-record synthetic
+ *        databases")
+ */
+class zipf_generator {
+private:
+    long n;
+    double theta, alpha, zetan, eta;
+    std::mt19937_64 rng;
+    std::uniform_real_distribution<double> uniform;
+
+    static double zeta(long n, double theta) {
+        double sum = 0;
+
+        for (long i = 1; i <= n; i++)
+            sum += 1 / std::pow((double) i, theta);
+
+        return sum;
+    }
+
+public:
+    zipf_generator(long n, double theta = 0.99, unsigned seed = 42)
+        : n(n), theta(theta), rng(seed), uniform(0, 1) {
+        double zeta2 = zeta(2, theta);
+
+        zetan = zeta(n, theta);
+        alpha = 1 / (1 - theta);
+        eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+    }
+
+    long operator()() {
+        double u = uniform(rng);
+        double uz = u * zetan;
+
+        if (uz < 1)
+            return 0;
+
+        if (uz < 1 + std::pow(0.5, theta))
+            return n > 1 ? 1 : 0;
+
+        long v = (long) (n * std::pow(eta * u - eta + 1, alpha));
+        return v < n ? v : n - 1;
+    }
+};
+
+/**
+ * @brief Gera a ordem de inserção de n chaves distintas
+ *
+ * Na distribuição de Zipf, a chave i é posta numa região escolhida pela
+ * distribuição, então as inserções se concentram em poucas regiões da
+ * árvore. A janela deslizante usa chaves crescentes.
+ */
+inline std::vector<int> unique_keys(distribution d, long n) {
+    std::vector<int> keys(n);
+
+    for (long i = 0; i < n; i++)
+        keys[i] = (int) i;
+
+    if (d == UNIFORM) {
+        std::mt19937 rng(42);
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+    } else if (d == ZIPFIAN) {
+        zipf_generator zipf(n);
+        std::vector<std::pair<long, int> > order(n);
+
+        for (long i = 0; i < n; i++)
+            order[i] = std::make_pair(zipf(), (int) i);
+
+        // Chaves da mesma região ficam lado a lado; a ordem de chegada é a
+        // ordem original
+        std::vector<std::pair<long, int> > by_key(order);
+        std::sort(by_key.begin(), by_key.end());
+
+        for (long i = 0; i < n; i++)
+            keys[by_key[i].second] = (int) i;
+    }
+
+    return keys;
+}
+
+/**
+ * @brief Gera n chaves de busca sobre uma árvore com as chaves [0, n)
+ *
+ * A janela deslizante busca entre as chaves mais recentes.
+ */
+inline std::vector<int> access_keys(distribution d, long n) {
+    std::vector<int> keys(n);
+    std::mt19937 rng(7);
+
+    if (d == ZIPFIAN) {
+        zipf_generator zipf(n);
+
+        // Espalha as chaves quentes pela árvore
+        for (long i = 0; i < n; i++)
+            keys[i] = (int) ((zipf() * 2654435761ul) % n);
+
+    } else {
+        for (long i = 0; i < n; i++) {
+            if (d == SEQUENTIAL)
+                keys[i] = (int) i;
+            else if (d == UNIFORM)
+                keys[i] = (int) (rng() % n);
+            else
+                keys[i] = (int) (n - 1 - rng() % (n < 1024 ? n : 1024));
+        }
+    }
+
+    return keys;
+}
+
+#endif // WORKLOAD_HPP
@@ -0,0 +1,195 @@
+/**
+ * @brief Cabeçalho para a árvore de intervalos sobre a árvore AVL
+ *
+ * @file avl_interval_tree.hpp
+ */
+
+#ifndef AVL_INTERVAL_TREE_HPP
+#define AVL_INTERVAL_TREE_HPP
+
+#include <iostream>
+#include <vector>
+
+#include "avl_tree.hpp"
+#include "avl_tree_augment.hpp"
+
+/**
+ * @brief Intervalo fechado [low, high]
+ *
+ * Os intervalos são ordenados pelo início e, no empate, pelo fim.
+ *
+ * @tparam T Tipo dos extremos
+ */
+template <class T> struct avl_interval {
+	T low;		//! Início do intervalo
+	T high;		//! Fim do intervalo
+
+	avl_interval() : low(), high() {}
+	avl_interval(const T& low, const T& high) : low(low), high(high) {}
+
+	/**
+	 * @brief Determina se o intervalo tem algum ponto em comum com [a, b]
+	 */
+	bool overlaps(const T& a, const T& b) const {
+		return !(high < a) && !(b < low);
+	}
+
+	friend bool operator <(const avl_interval& a, const avl_interval& b) {
+		return a.low < b.low || (!(b.low < a.low) && a.high < b.high);
+	}
+
+	friend bool operator ==(const avl_interval& a, const avl_interval& b) {
+		return a.low == b.low && a.high == b.high;
+	}
+
+	friend std::ostream & operator <<(std::ostream & out, const avl_interval& i) {
+		return out << '[' << i.low << ", " << i.high << ']';
+	}
+};
+
+/**
+ * @brief Projeção do fim de um intervalo, usada no aumento da árvore
+ */
+struct avl_interval_high {
+	template <class U> const U& operator()(const avl_interval<U>& i) const {
+		return i.high;
+	}
+};
+
+/**
+ * @brief Árvore de intervalos
+ *
+ * Os intervalos ficam numa `avl_tree` ordenada pelo início, aumentada com o
+ * maior fim de cada subárvore. O aumento é mantido pelas próprias rotações
+ * da árvore, então inserir e remover continuam custando O(log n), e uma
+ * busca pula as subárvores em que todos os intervalos terminam antes do
+ * começo dela.
+ *
+ * Intervalos idênticos não podem ser guardados duas vezes.
+ *
+ * @tparam T Tipo numérico dos extremos
+ * @tparam Stats Política de instrumentação
+ * @tparam Balance Política de balanceamento
+ */
+template <
+	class T,
+	class Stats = avl_no_stats,
+	class Balance = avl_strict_balance
+> class avl_interval_tree {
+public:
+
+	typedef avl_interval<T> interval;
+
+	typedef avl_tree<
+		interval,
+		std::less<interval>,
+		std::equal_to<interval>,
+		Stats,
+		Balance,
+		avl_max<interval, avl_interval_high>
+	> tree_t;
+
+private:
+
+	tree_t tree;	//! Intervalos ordenados pelo início
+
+public:
+
+	/**
+	 * @brief Obtém a árvore dos intervalos
+	 *
+	 * @return const tree_t& A árvore
+	 */
+	const tree_t & get_tree() const {
+		return tree;
+	}
+
+	/**
+	 * @brief Obtém a quantidade de intervalos
+	 *
+	 * @return int a quantidade de intervalos da árvore
+	 */
+	int size() const {
+		return tree.size();
+	}
+
+	/**
+	 * @brief Determina se um intervalo existe na árvore
+	 *
+	 * @param low Início do intervalo
+	 * @param high Fim do intervalo
+	 */
+	bool includes(const T& low, const T& high) const {
+		return tree.includes(interval(low, high));
+	}
+
+	/**
+	 * @brief Insere um intervalo
+	 *
+	 * @param low Início do intervalo
+	 * @param high Fim do intervalo, maior ou igual ao início
+	 */
+	void insert(const T& low, const T& high) {
+		if (high < low)
+			throw "Invalid interval";
+
+		tree.insert(interval(low, high));
+	}
+
+	/**
+	 * @brief Remove um intervalo
+	 *
+	 * @param low Início do intervalo
+	 * @param high Fim do intervalo
+	 */
+	void remove(const T& low, const T& high) {
+		tree.remove(interval(low, high));
+	}
+
+	/**
+	 * @brief Percorre, em ordem de início, os intervalos que têm algum
+	 *        ponto em comum com [a, b]
+	 *
+	 * @param a Início da busca
+	 * @param b Fim da busca
+	 * @param fn Função chamada com cada intervalo encontrado
+	 */
+	template <class Function> void overlapping(
+		const T& a,
+		const T& b,
+		Function fn
+	) const {
+		tree.for_each_where(
+			[&](const T& max_high) { return !(max_high < a); },
+			[&](const interval& i) { return b < i.low; },
+			fn
+		);
+	}
+
+	/**
+	 * @brief Obtém os intervalos que têm algum ponto em comum com [a, b]
+	 *
+	 * @param a Início da busca
+	 * @param b Fim da busca
+	 * @return std::vector<interval> Os intervalos, em ordem de início
+	 */
+	std::vector<interval> overlapping(const T& a, const T& b) const {
+		std::vector<interval> found;
+
+		overlapping(a, b, [&](const interval& i) { found.push_back(i); });
+
+		return found;
+	}
+
+	/**
+	 * @brief Obtém os intervalos que contêm um ponto
+	 *
+	 * @param point Ponto procurado
+	 * @return std::vector<interval> Os intervalos, em ordem de início
+	 */
+	std::vector<interval> stab(const T& point) const {
+		return overlapping(point, point);
+	}
+};
+
+#endif // AVL_INTERVAL_TREE_HPP
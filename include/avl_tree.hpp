@@ -9,476 +9,3413 @@
 #ifndef AVL_TREE_HPP
 #define AVL_TREE_HPP
 
+#include <atomic>
+#include <cctype>
+#include <cstdio>
 #include <functional>
 #include <iterator>
 #include <iostream>
 #include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
 #include <sstream>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
-#include <queue>
-#include <stack>
+
+/**
+ * @brief Operações medidas pelas políticas de instrumentação
+ */
+enum avl_operation {
+	AVL_INSERT,
+	AVL_UPDATE,
+	AVL_REMOVE,
+	AVL_FIND,
+	AVL_POP,
+	AVL_POPLEFT,
+	AVL_OPERATIONS		//! Número de operações
+};
+
+/**
+ * @brief Política de instrumentação vazia, que não mede nada
+ * 
+ * A árvore notifica a política de instrumentação pelas funções estáticas
+ * abaixo. Como todas são vazias, a instrumentação desaparece na compilação.
+ * Veja `avl_tree_stats.hpp` para uma política que conta os eventos.
+ */
+struct avl_no_stats {
+
+	/**
+	 * @brief Retrato dos contadores
+	 */
+	struct snapshot {};
+
+	/**
+	 * @brief Marca o começo e o fim de uma operação da árvore
+	 */
+	struct scope {
+		explicit scope(avl_operation) {}
+	};
+
+	static void compared() {}			//! Uma comparação entre informações
+	static void visited() {}			//! Uma visita a um nó
+	static void rotated(bool) {}		//! Uma rotação simples ou dupla
+	static void allocated() {}			//! Uma alocação de nó ou informação
+	static void deallocated() {}		//! Uma liberação de nó ou informação
+	static void retraced(bool) {}		//! Um nó reajustado na volta da descida
+
+	static snapshot stats() { return snapshot(); }
+	static void reset() {}
+};
+
+/**
+ * @brief Política de balanceamento pela altura das subárvores
+ * 
+ * Um nó é rebalanceado quando a diferença de altura entre as subárvores
+ * passa de `Slack`. Com `Slack` igual a 1, é a árvore AVL estrita; valores
+ * maiores aceitam árvores mais altas em troca de menos rotações.
+ * 
+ * @tparam Slack Maior diferença de altura aceita entre as subárvores
+ */
+template <int Slack> struct avl_height_balance {
+	static_assert(Slack >= 1, "Slack must be at least 1");
+
+	//! Árvores com esta política podem ser juntadas por `join`
+	typedef std::true_type joinable;
+
+	/**
+	 * @brief Restaura o balanceamento de um nó depois de uma inserção num
+	 *        dos galhos
+	 */
+	template <class Tree> static void inserted(Tree& t) {
+		retrace(t);
+	}
+
+	/**
+	 * @brief Restaura o balanceamento de um nó depois de uma remoção num
+	 *        dos galhos
+	 */
+	template <class Tree> static void removed(Tree& t) {
+		retrace(t);
+	}
+
+	/**
+	 * @brief Junta duas árvores balanceadas e um nó entre elas
+	 * 
+	 * O nó é pendurado na espinha da árvore mais alta, na altura da mais
+	 * baixa, e o caminho até a raiz é reajustado como numa inserção. O custo
+	 * é proporcional à diferença de altura entre as árvores.
+	 * 
+	 * @param l Árvore com as informações menores, ou nullptr
+	 * @param m Nó sem galhos, com a informação do meio
+	 * @param r Árvore com as informações maiores, ou nullptr
+	 * @return Tree* Raiz da árvore juntada
+	 */
+	template <class Tree> static Tree* join(Tree* l, Tree* m, Tree* r) {
+		int lh = l ? l->_height : 0,
+			rh = r ? r->_height : 0;
+
+		if (lh > rh + Slack) {
+			Tree::own(l);
+			l->right = join(l->right, m, r);
+			l->update_size();
+			retrace(*l);
+			return l;
+		}
+
+		if (rh > lh + Slack) {
+			Tree::own(r);
+			r->left = join(l, m, r->left);
+			r->update_size();
+			retrace(*r);
+			return r;
+		}
+
+		m->left = l;
+		m->right = r;
+		m->update_size();
+		m->update_height();
+
+		return m;
+	}
+
+	/**
+	 * @brief Determina se a altura guardada num nó é a calculada a partir
+	 *        dos galhos e se o nó está balanceado
+	 */
+	template <class Tree> static bool valid(const Tree& t) {
+		int lh = t.left ? t.left->_height : 0,
+			rh = t.right ? t.right->_height : 0;
+
+		return t._height == (rh > lh ? rh : lh) + 1 && rh - lh <= Slack && lh - rh <= Slack;
+	}
+
+private:
+
+	template <class Tree> static void retrace(Tree& t) {
+		t.update_height();
+
+		int balance = t.balance_factor();
+
+		if (balance < -Slack) {
+			bool twice = t.left->balance_factor() > 0;
+
+			if (twice) {
+				Tree::own(t.left)->rotate_left();
+				t.left->left->update_height();
+				t.left->update_height();
+			}
+
+			t.rotate_right();
+			t.right->update_height();
+			t.update_height();
+
+			Tree::stats_t::rotated(twice);
+
+		} else if (balance > Slack) {
+			bool twice = t.right->balance_factor() < 0;
+
+			if (twice) {
+				Tree::own(t.right)->rotate_right();
+				t.right->right->update_height();
+				t.right->update_height();
+			}
+
+			t.rotate_left();
+			t.left->update_height();
+			t.update_height();
+
+			Tree::stats_t::rotated(twice);
+		}
+	}
+};
+
+//! Árvore AVL estrita: as alturas das subárvores diferem em no máximo 1
+typedef avl_height_balance<1> avl_strict_balance;
+
+//! Árvore AVL relaxada: as alturas das subárvores diferem em no máximo K
+template <int K = 2> using avl_relaxed_balance = avl_height_balance<K>;
+
+/**
+ * @brief Política de balanceamento WAVL (weak AVL, Haeupler, Sen e Tarjan)
+ * 
+ * Cada nó tem um posto, guardado no lugar da altura como posto + 1. A
+ * diferença de posto entre pai e filho é 1 ou 2, e as folhas têm posto 0.
+ * Só com inserções, a árvore é uma árvore AVL; com remoções, ela fica no
+ * máximo tão alta quanto uma árvore rubro-negra, mas cada remoção faz no
+ * máximo duas rotações, e o número de promoções e rebaixamentos é O(1)
+ * amortizado.
+ * 
+ * Com esta política, `height()` retorna o posto + 1, que é maior ou igual à
+ * altura real.
+ */
+struct avl_weak_balance {
+
+	//! Os postos não permitem juntar árvores pela altura
+	typedef std::false_type joinable;
+
+	/**
+	 * @brief Restaura o balanceamento de um nó depois de uma inserção num
+	 *        dos galhos
+	 */
+	template <class Tree> static void inserted(Tree& t) {
+		int r = rank(&t);
+
+		if (rank(t.left) == r) {
+			if (r - rank(t.right) == 1) {
+				t._height++;
+
+			} else if (r - rank(t.left->right) == 2) {
+				t.rotate_right();
+				t.right->_height--;
+
+				Tree::stats_t::rotated(false);
+
+			} else {
+				Tree::own(t.left)->rotate_left();
+				t.rotate_right();
+				t._height++;
+				t.left->_height--;
+				t.right->_height--;
+
+				Tree::stats_t::rotated(true);
+			}
+
+		} else if (rank(t.right) == r) {
+			if (r - rank(t.left) == 1) {
+				t._height++;
+
+			} else if (r - rank(t.right->left) == 2) {
+				t.rotate_left();
+				t.left->_height--;
+
+				Tree::stats_t::rotated(false);
+
+			} else {
+				Tree::own(t.right)->rotate_right();
+				t.rotate_left();
+				t._height++;
+				t.right->_height--;
+				t.left->_height--;
+
+				Tree::stats_t::rotated(true);
+			}
+		}
+	}
+
+	/**
+	 * @brief Restaura o balanceamento de um nó depois de uma remoção num
+	 *        dos galhos
+	 */
+	template <class Tree> static void removed(Tree& t) {
+		if (t.is_leaf()) {
+			t._height = 1;
+			return;
+		}
+
+		int r = rank(&t);
+
+		if (r - rank(t.left) == 3) {
+			Tree* y = t.right;
+			int ry = rank(y);
+
+			if (r - ry == 2) {
+				t._height--;
+
+			} else if (ry - rank(y->left) == 2 && ry - rank(y->right) == 2) {
+				t._height--;
+				Tree::own(t.right)->_height--;
+
+			} else if (ry - rank(y->right) == 1) {
+				t.rotate_left();
+				t._height++;
+				t.left->_height = t.left->is_leaf() ? 1 : t.left->_height - 1;
+
+				Tree::stats_t::rotated(false);
+
+			} else {
+				Tree::own(t.right)->rotate_right();
+				t.rotate_left();
+				t._height += 2;
+				t.left->_height -= 2;
+				t.right->_height--;
+
+				Tree::stats_t::rotated(true);
+			}
+
+		} else if (r - rank(t.right) == 3) {
+			Tree* y = t.left;
+			int ry = rank(y);
+
+			if (r - ry == 2) {
+				t._height--;
+
+			} else if (ry - rank(y->left) == 2 && ry - rank(y->right) == 2) {
+				t._height--;
+				Tree::own(t.left)->_height--;
+
+			} else if (ry - rank(y->left) == 1) {
+				t.rotate_right();
+				t._height++;
+				t.right->_height = t.right->is_leaf() ? 1 : t.right->_height - 1;
+
+				Tree::stats_t::rotated(false);
+
+			} else {
+				Tree::own(t.left)->rotate_left();
+				t.rotate_right();
+				t._height += 2;
+				t.right->_height -= 2;
+				t.left->_height--;
+
+				Tree::stats_t::rotated(true);
+			}
+		}
+	}
+
+	/**
+	 * @brief Determina se as diferenças de posto de um nó para os galhos
+	 *        são 1 ou 2, e se o nó tem posto 0 caso seja uma folha
+	 */
+	template <class Tree> static bool valid(const Tree& t) {
+		int r = rank(&t),
+			ld = r - rank(t.left),
+			rd = r - rank(t.right);
+
+		return (ld == 1 || ld == 2) && (rd == 1 || rd == 2) && (t.left || t.right || r == 0);
+	}
+
+private:
+
+	//! Posto de um nó; nós ausentes têm posto -1
+	template <class Tree> static int rank(const Tree* t) {
+		return t ? t->_height - 1 : -1;
+	}
+};
+
+/**
+ * @brief Aumento vazio, que não mantém nenhum agregado nos nós
+ * 
+ * Um aumento é um monoide sobre as informações: `lift` leva uma informação
+ * a um valor, `combine` junta dois valores em ordem e `identity` é o valor
+ * neutro. A árvore guarda em cada nó a combinação dos valores da sua
+ * subárvore, em ordem, e a mantém nas rotações e reajustes. Veja
+ * `avl_tree_augment.hpp` para os aumentos prontos.
+ */
+struct avl_no_augment {
+	struct value_type {};
+
+	template <class T> static value_type lift(const T&) { return value_type(); }
+	static value_type identity() { return value_type(); }
+	static value_type combine(value_type, value_type) { return value_type(); }
+};
+
+/**
+ * @brief Espaço do agregado num nó
+ * 
+ * Sem aumento, o espaço é uma base vazia e não ocupa memória no nó.
+ */
+template <class Augment> struct avl_augment_slot {
+	typename Augment::value_type _aggregate;	//! Agregado da subárvore
+};
+
+template <> struct avl_augment_slot<avl_no_augment> {};
+
+template <class T> struct avl_bounds;
+
+/**
+ * @brief Guarda um objeto função, como base vazia se ele não tiver estado
+ * 
+ * @tparam F Tipo do objeto função
+ * @tparam Tag Distingue duas bases do mesmo tipo
+ */
+template <class F, int Tag, bool Empty = std::is_empty<F>::value> struct avl_function_slot {
+	F _function;	//! Objeto função
+
+	avl_function_slot() : _function() {}
+	explicit avl_function_slot(const F& f) : _function(f) {}
+
+	const F& function() const { return _function; }
+};
+
+template <class F, int Tag> struct avl_function_slot<F, Tag, true> : private F {
+	avl_function_slot() {}
+	explicit avl_function_slot(const F& f) : F(f) {}
+
+	const F& function() const { return *this; }
+};
+
+/**
+ * @brief Determina se os dois comparadores são vazios e construíveis por
+ *        padrão, e então podem ser criados em qualquer nó sem custo
+ */
+template <class Compare, class Equal> struct avl_stateless_compare
+	: std::integral_constant<bool,
+		std::is_empty<Compare>::value &&
+		std::is_empty<Equal>::value &&
+		std::is_default_constructible<Compare>::value &&
+		std::is_default_constructible<Equal>::value
+	> {};
+
+/**
+ * @brief Comparadores de uma árvore
+ * 
+ * São passados por referência do objeto raiz aos nós durante os percursos.
+ * Comparadores sem estado, como `std::less`, ficam como bases vazias e não
+ * ocupam memória no nó.
+ */
+template <
+	class Compare,
+	class Equal,
+	bool Stateless = avl_stateless_compare<Compare, Equal>::value
+> struct avl_compare_slot
+	: avl_function_slot<Compare, 0>, avl_function_slot<Equal, 1> {
+
+	avl_compare_slot() {}
+
+	avl_compare_slot(const Compare& is_less, const Equal& is_equal)
+		: avl_function_slot<Compare, 0>(is_less),
+		  avl_function_slot<Equal, 1>(is_equal) {}
+
+	const Compare& key_comp() const {
+		return avl_function_slot<Compare, 0>::function();
+	}
+
+	const Equal& key_eq() const {
+		return avl_function_slot<Equal, 1>::function();
+	}
+};
+
+/**
+ * @brief Comparadores com estado, como uma tabela de ordenação
+ * 
+ * Ficam uma vez só, no heap, e são apontados só pelo objeto raiz; os nós
+ * guardam um ponteiro nulo. Cópias da árvore compartilham os mesmos
+ * comparadores, que não mudam depois de criados, por uma contagem de
+ * referências.
+ */
+template <class Compare, class Equal> struct avl_compare_slot<Compare, Equal, false> {
+	/**
+	 * @brief Comparadores compartilhados pelas cópias de uma árvore
+	 */
+	struct functions {
+		Compare is_less;			//! Comparador de ordem
+		Equal is_equal;				//! Comparador de igualdade
+		std::atomic<int> refs;		//! Número de árvores que apontam para eles
+
+		functions(const Compare& is_less, const Equal& is_equal)
+			: is_less(is_less), is_equal(is_equal), refs(1) {}
+	};
+
+	functions* _functions;	//! Comparadores, ou nullptr num nó
+
+	avl_compare_slot() : _functions(nullptr) {}
+
+	avl_compare_slot(const Compare& is_less, const Equal& is_equal)
+		: _functions(new functions(is_less, is_equal)) {}
+
+	avl_compare_slot(const avl_compare_slot & model) : _functions(model._functions) {
+		if (_functions)
+			_functions->refs++;
+	}
+
+	avl_compare_slot & operator = (avl_compare_slot model) {
+		swap(*this, model);
+		return *this;
+	}
+
+	~avl_compare_slot() {
+		if (_functions && --_functions->refs == 0)
+			delete _functions;
+	}
+
+	friend void swap(avl_compare_slot & first, avl_compare_slot & other) {
+		std::swap(first._functions, other._functions);
+	}
+
+	const Compare& key_comp() const {
+		return _functions->is_less;
+	}
+
+	const Equal& key_eq() const {
+		return _functions->is_equal;
+	}
+};
+
+/**
+ * @brief Informação guardada dentro do próprio nó
+ * 
+ * Imita o ponteiro usado para os outros tipos: pode estar vazia, comparando
+ * igual a nullptr, e é lida com `*` e `->`. Mover a informação de um nó a
+ * outro copia o valor, o que para um número custa menos que seguir um
+ * ponteiro, e o nó não precisa de uma segunda alocação.
+ * 
+ * @tparam T Tipo aritmético da informação
+ */
+template <class T> class avl_inline_info {
+private:
+	T value;		//! Informação
+	bool present;	//! Se há uma informação
+
+public:
+	avl_inline_info(std::nullptr_t = nullptr) : value(), present(false) {}
+	explicit avl_inline_info(const T& data) : value(data), present(true) {}
+
+	T& operator * () { return value; }
+	const T& operator * () const { return value; }
+	T* operator -> () { return &value; }
+	const T* operator -> () const { return &value; }
+
+	explicit operator bool () const { return present; }
+
+	bool operator == (std::nullptr_t) const { return !present; }
+	bool operator != (std::nullptr_t) const { return present; }
+
+	bool operator == (const avl_inline_info & other) const {
+		return present == other.present && (!present || value == other.value);
+	}
+
+	bool operator != (const avl_inline_info & other) const {
+		return !(*this == other);
+	}
+};
+
+/**
+ * @brief Informação alocada à parte, com uma cópia do prefixo da chave
+ *        guardada no próprio nó
+ * 
+ * Comporta-se como o ponteiro da informação; o prefixo é calculado sempre
+ * que o ponteiro muda.
+ * 
+ * @tparam T Tipo da informação
+ * @tparam Compare Comparador, que define `prefix_type` e `prefix`
+ */
+template <class T, class Compare> class avl_prefixed_info {
+public:
+
+	typedef typename Compare::prefix_type prefix_type;
+
+private:
+
+	T* data;			//! Informação
+	prefix_type key;	//! Prefixo da informação
+
+public:
+
+	avl_prefixed_info(std::nullptr_t = nullptr) : data(nullptr), key() {}
+	avl_prefixed_info(T* data) : data(data), key(data ? Compare::prefix(*data) : prefix_type()) {}
+
+	T& operator * () const { return *data; }
+	T* operator -> () const { return data; }
+	operator T* () const { return data; }
+
+	const prefix_type& prefix() const { return key; }
+};
+
+/**
+ * @brief Sonda vazia, para quando os nós não guardam prefixos
+ */
+struct avl_no_probe {};
+
+//! Leva qualquer tipo a void, para detectar membros por SFINAE
+template <class> struct avl_void { typedef void type; };
+
+/**
+ * @brief Determina se um comparador define prefixos das chaves
+ */
+template <class Compare, class Enable = void> struct avl_has_prefix : std::false_type {};
+
+template <class Compare> struct avl_has_prefix<
+	Compare, typename avl_void<typename Compare::prefix_type>::type
+> : std::true_type {};
+
+/**
+ * @brief Forma de guardar a informação num nó: por padrão, num objeto
+ *        alocado à parte e apontado pelo nó
+ * 
+ * Além do ponteiro, a forma define a sonda de uma busca, calculada uma vez
+ * a partir da informação procurada, e `order`, que tenta decidir a ordem
+ * entre a sonda e um nó sem ler a informação dele (zero quando não dá).
+ */
+template <class T, class Compare, class Enable = void> struct avl_info_storage {
+	typedef T* pointer;
+	typedef std::false_type inline_type;
+	typedef avl_no_probe probe_type;
+
+	static probe_type probe(const T&) { return probe_type(); }
+	static int order(const probe_type&, const pointer&) { return 0; }
+	static void refresh(pointer&) {}
+};
+
+/**
+ * @brief Tipos aritméticos são guardados dentro do nó
+ */
+template <class T, class Compare> struct avl_info_storage<
+	T, Compare, typename std::enable_if<std::is_arithmetic<T>::value>::type
+> {
+	typedef avl_inline_info<T> pointer;
+	typedef std::true_type inline_type;
+	typedef avl_no_probe probe_type;
+
+	static probe_type probe(const T&) { return probe_type(); }
+	static int order(const probe_type&, const pointer&) { return 0; }
+	static void refresh(pointer&) {}
+};
+
+/**
+ * @brief Com um comparador que define prefixos, como `avl_prefix_less`, o
+ *        nó guarda o prefixo da chave junto ao ponteiro, e a maior parte
+ *        das comparações é decidida sem ler a informação
+ */
+template <class T, class Compare> struct avl_info_storage<
+	T, Compare, typename std::enable_if<
+		!std::is_arithmetic<T>::value && avl_has_prefix<Compare>::value
+	>::type
+> {
+	typedef avl_prefixed_info<T, Compare> pointer;
+	typedef std::false_type inline_type;
+	typedef typename Compare::prefix_type probe_type;
+
+	static probe_type probe(const T& data) { return Compare::prefix(data); }
+
+	static int order(const probe_type& probe, const pointer& info) {
+		return (info.prefix() < probe) - (probe < info.prefix());
+	}
+
+	/**
+	 * @brief Recalcula o prefixo, depois que a informação foi alterada
+	 */
+	static void refresh(pointer& info) { info = pointer(&*info); }
+};
 
 /**
  * @brief Árvore AVL
  * 
  * @tparam T Tipo de valor armazenado na árvore
+ * @tparam Stats Política de instrumentação
+ * @tparam Balance Política de balanceamento
+ * @tparam Augment Agregado mantido em cada subárvore
  */
 template <
 	class T,
 	class Compare = std::less<T>,
-	class Equal = std::equal_to<T>
-> class avl_tree {
+	class Equal = std::equal_to<T>,
+	class Stats = avl_no_stats,
+	class Balance = avl_strict_balance,
+	class Augment = avl_no_augment
+> class avl_tree
+	: private avl_augment_slot<Augment>,
+	  private avl_compare_slot<Compare, Equal> {
 private:
 
+	friend Balance;
+
+	typedef avl_augment_slot<Augment> slot_t;
+	typedef avl_compare_slot<Compare, Equal> cmp_t;
+
+	//! Determina se os nós guardam um agregado
+	typedef std::integral_constant<bool,
+		!std::is_same<Augment, avl_no_augment>::value
+	> augmented_t;
+
+	//! Determina se os nós guardam a primeira e a última informação
+	typedef std::is_same<Augment, avl_bounds<T> > bounded_t;
+
 	typedef Compare compare_t;
 	typedef Equal equal_t;
+	typedef Stats stats_t;
+
+public:
+
+	typedef typename Augment::value_type aggregate_type;	//! Tipo do agregado
+
+	class reclaimer;	//! Nós liberados aos poucos
+
+private:
+
+	//! Determina se T é lido e escrito como um número inteiro em decimal
+	typedef std::integral_constant<bool,
+		std::is_integral<T>::value &&
+		!std::is_same<T, bool>::value &&
+		!std::is_same<T, char>::value &&
+		!std::is_same<T, signed char>::value &&
+		!std::is_same<T, unsigned char>::value &&
+		!std::is_same<T, wchar_t>::value &&
+		!std::is_same<T, char16_t>::value &&
+		!std::is_same<T, char32_t>::value
+	> decimal_t;
+
+	typedef avl_info_storage<T, Compare> storage_t;
+	typedef typename storage_t::pointer info_ptr;	//! Ponteiro para a informação, ou a própria
+	typedef typename storage_t::inline_type inline_t;
+	typedef typename storage_t::probe_type probe_t;
+
+	//! Determina se as comparações podem ser feitas direto nos valores
+	typedef std::integral_constant<bool,
+		std::is_arithmetic<T>::value &&
+		std::is_same<Compare, std::less<T> >::value &&
+		std::is_same<Equal, std::equal_to<T> >::value
+	> native_compare_t;
+
+	info_ptr info;		//! Informação do nó
+	avl_tree* left;		//! Nó à esquerda
+	avl_tree* right;	//! Nó à direita
+
+	int _size;			//! Número de elementos vivos na árvore
+	int _dead;			//! Número de lápides na árvore
+	short _height;		//! Altura da árvore
+	bool _tombstone;	//! Se a informação do nó foi removida preguiçosamente
+
+	std::atomic<int> _shares;	//! Número de árvores além da primeira que apontam para o nó
+
+	/**
+	 * @brief Calcula o fator de balanceamento da árvore
+	 * 
+	 * @return int o fator de balanceamento do nó
+	 */
+	int balance_factor() const {
+		return (right ? right->height() : 0) - (left ? left->height() : 0);
+	}
+
+	/**
+	 * @brief Troca o conteúdo de dois nós, sem trocar os comparadores, que
+	 *        ficam sempre no objeto raiz
+	 * 
+	 * As contagens de compartilhamento também ficam, pois contam os
+	 * ponteiros para o endereço do nó, e não para o seu conteúdo. Os dois
+	 * nós não podem ser compartilhados.
+	 * 
+	 * @param first Primeiro nó
+	 * @param other Outro nó
+	 */
+	static void swap_nodes(avl_tree & first, avl_tree & other) {
+		using std::swap;
+
+		swap(first.info, other.info);
+		swap(first.left, other.left);
+		swap(first.right, other.right);
+		swap(first._height, other._height);
+		swap(first._size, other._size);
+		swap(first._dead, other._dead);
+		swap(first._tombstone, other._tombstone);
+		swap(static_cast<slot_t&>(first), static_cast<slot_t&>(other));
+	}
+
+	/**
+	 * @brief Libera a memória de um galho e apaga ele, caso esteja vazio
+	 * 
+	 * @param ptr Referência de ponteiro do galho
+	 */
+	inline void delete_if_empty(avl_tree* & ptr) {
+		if (!ptr)
+			return;
+
+		if (ptr->empty()) {
+			delete_node(ptr);
+			ptr = nullptr;
+		}
+	}
+
+	/**
+	 * @brief Põe no lugar de um nó já sem informação o seu único galho, sem
+	 *        copiar informações
+	 * 
+	 * @param child O único galho do nó, ou nullptr se o nó for uma folha
+	 */
+	void splice(avl_tree* child) {
+		if (!child)
+			return;
+
+		own(child);
+		left = right = nullptr;
+
+		swap_nodes(*this, *child);
+		delete_node(child);
+	}
+
+	/**
+	 * @brief Recalcula a altura da árvore a partir das subárvores
+	 */
+	void update_height() {
+		int rh = right ? right->_height : 0,
+			lh = left ? left->_height : 0;
+
+		_height = (rh > lh ? rh : lh) + 1;
+	}
+
+	/**
+	 * @brief Recalcula o número de elementos e de lápides da árvore a partir
+	 *        das subárvores
+	 */
+	void update_size() {
+		_size = (info && !_tombstone ? 1 : 0)
+			+ (left ? left->_size : 0)
+			+ (right ? right->_size : 0);
+
+		_dead = (_tombstone ? 1 : 0)
+			+ (left ? left->_dead : 0)
+			+ (right ? right->_dead : 0);
+
+		update_aggregate(augmented_t());
+	}
+
+	/**
+	 * @brief Recalcula o agregado da árvore a partir das subárvores
+	 */
+	void update_aggregate(std::true_type) {
+		aggregate_type acc = own_aggregate();
+
+		if (left)
+			acc = Augment::combine(left->_aggregate, acc);
+
+		if (right)
+			acc = Augment::combine(acc, right->_aggregate);
+
+		this->_aggregate = acc;
+	}
+
+	void update_aggregate(std::false_type) {}
+
+	/**
+	 * @brief Obtém o valor da informação do próprio nó no agregado
+	 */
+	aggregate_type own_aggregate() const {
+		return info && !_tombstone ? Augment::lift(*info) : Augment::identity();
+	}
+
+	/**
+	 * @brief Rotação à esquerda
+	 * 
+	 * Só reorganiza os nós e recalcula os tamanhos; as alturas ficam a
+	 * cargo da política de balanceamento. O nó que desce é copiado antes,
+	 * se for compartilhado; o resto só muda de pai.
+	 */
+	void rotate_left() {
+		using std::swap;
+
+		avl_tree* aux = own(this->right);
+
+		this->right = aux->left;
+
+		swap_nodes(*this, *aux);
+		this->left = aux;
+
+		aux->update_size();
+		update_size();
+	}
+
+	/**
+	 * @brief Rotação à direita
+	 * 
+	 * Só reorganiza os nós e recalcula os tamanhos; as alturas ficam a
+	 * cargo da política de balanceamento. O nó que desce é copiado antes,
+	 * se for compartilhado; o resto só muda de pai.
+	 */
+	void rotate_right() {
+		using std::swap;
+
+		avl_tree* aux = own(this->left);
+
+		this->left = aux->right;
+
+		swap_nodes(*this, *aux);
+		this->right = aux;
+
+		aux->update_size();
+		update_size();
+	}
+
+	/**
+	 * @brief Recalcula o tamanho da árvore e balanceia se necessário
+	 * 
+	 * @param grew Se a alteração num dos galhos foi uma inserção
+	 */
+	void recalculate(bool grew) {
+		int old_height = _height;
+		const info_ptr old_info = info;
+
+		if (empty()) {
+			_height = 0;
+			_size = 0;
+			_dead = 0;
+			update_aggregate(augmented_t());
+
+		} else {
+			update_size();
+
+			if (grew)
+				Balance::inserted(*this);
+			else
+				Balance::removed(*this);
+		}
+
+		Stats::retraced(_height != old_height || info != old_info);
+	}
+
+	/**
+	 * @brief Registra mais uma árvore apontando para um nó
+	 * 
+	 * @param node Nó, ou nullptr
+	 * @return avl_tree* O próprio nó
+	 */
+	static avl_tree* share(avl_tree* node) {
+		if (node)
+			node->_shares.fetch_add(1, std::memory_order_relaxed);
+
+		return node;
+	}
+
+	/**
+	 * @brief Copia um nó compartilhado, com a sua informação, mas
+	 *        compartilhando os galhos com o original
+	 * 
+	 * @param node Nó copiado
+	 * @return avl_tree* A cópia, que só pertence a quem a pediu
+	 */
+	static avl_tree* clone(const avl_tree* node) {
+		info_ptr data = nullptr;
+
+		if (node->info)
+			data = new_info(*node->info);
+
+		avl_tree* copy;
+
+		try {
+			copy = new_node();
+		} catch (...) {
+			if (data)
+				delete_info(data);
+
+			throw;
+		}
+
+		copy->info = data;
+		copy->left = share(node->left);
+		copy->right = share(node->right);
+		copy->_height = node->_height;
+		copy->_size = node->_size;
+		copy->_dead = node->_dead;
+		copy->_tombstone = node->_tombstone;
+		static_cast<slot_t&>(*copy) = static_cast<const slot_t&>(*node);
+
+		return copy;
+	}
+
+	/**
+	 * @brief Garante que um galho só pertence a esta árvore, antes de ele
+	 *        ser alterado
+	 * 
+	 * Um galho compartilhado com cópias da árvore é trocado por uma cópia
+	 * dele, e a referência ao original passa para ela. Chamada a cada nó do
+	 * caminho alterado, copia só esse caminho, e o resto dos nós continua
+	 * compartilhado.
+	 * 
+	 * @param ptr Referência de ponteiro do galho, que recebe a cópia
+	 * @return avl_tree* O galho, ou nullptr
+	 */
+	static avl_tree* own(avl_tree* & ptr) {
+		if (ptr && ptr->_shares.load(std::memory_order_acquire) > 0)
+			unshare(ptr);
+
+		return ptr;
+	}
+
+	/**
+	 * @brief Troca um galho compartilhado por uma cópia dele
+	 * 
+	 * Fica fora de `own` para que a verificação, feita a cada nível das
+	 * descidas, continue pequena.
+	 * 
+	 * @param ptr Referência de ponteiro do galho, que recebe a cópia
+	 */
+	static void unshare(avl_tree* & ptr) {
+		avl_tree* copy = clone(ptr);
+		delete_node(ptr);
+		ptr = copy;
+	}
+
+	/**
+	 * @brief Determina se uma informação é menor que outra
+	 */
+	static bool less_than(const cmp_t& cmp, const T& a, const T& b) {
+		Stats::compared();
+		return cmp.key_comp()(a, b);
+	}
+
+	/**
+	 * @brief Determina se duas informações são iguais
+	 */
+	static bool equals(const cmp_t& cmp, const T& a, const T& b) {
+		Stats::compared();
+		return cmp.key_eq()(a, b);
+	}
+
+	/**
+	 * @brief Marca o construtor de nós, que não cria comparadores
+	 */
+	struct node_tag {};
+
+	/**
+	 * @brief Construtor de um nó ou árvore vazia
+	 * 
+	 * @param cmp Comparadores, que só o objeto raiz guarda
+	 */
+	explicit avl_tree(node_tag, const cmp_t& cmp = cmp_t())
+		: cmp_t(cmp), _shares(0) {
+		info = nullptr;
+		left = nullptr;
+		right = nullptr;
+		_height = 0;
+		_size = 0;
+		_dead = 0;
+		_tombstone = false;
+
+		update_aggregate(augmented_t());
+	}
+
+	/**
+	 * @brief Aloca um nó vazio
+	 */
+	static avl_tree* new_node() {
+		Stats::allocated();
+		return new avl_tree(node_tag());
+	}
+
+	/**
+	 * @brief Solta uma referência a um nó
+	 * 
+	 * @param node Nó
+	 * @return true se era a última referência, e o nó pode ser desmontado
+	 * @return false se outra árvore ainda aponta para o nó
+	 */
+	static bool release(avl_tree* node) {
+		return !(node->_shares.load(std::memory_order_acquire) > 0 &&
+			node->_shares.fetch_sub(1, std::memory_order_acq_rel) > 0);
+	}
+
+	/**
+	 * @brief Libera um nó que só pertence a quem chamou, sem os galhos
+	 * 
+	 * @param node Nó
+	 * @param l Recebe o galho esquerdo, se ele também for só de quem chamou
+	 * @param r Recebe o galho direito, se ele também for só de quem chamou
+	 */
+	static void free_node(avl_tree* node, avl_tree* & l, avl_tree* & r) {
+		l = node->left && release(node->left) ? node->left : nullptr;
+		r = node->right && release(node->right) ? node->right : nullptr;
+		node->left = node->right = nullptr;
+
+		Stats::deallocated();
+		delete node;
+	}
+
+	/**
+	 * @brief Libera uma subárvore que só pertence a quem chamou, subindo o
+	 *        galho esquerdo por rotações até a raiz não ter um
+	 * 
+	 * Não usa memória extra, para qualquer altura.
+	 * 
+	 * @param node Raiz da subárvore
+	 */
+	static void delete_by_rotations(avl_tree* node) {
+		while (node) {
+			avl_tree* l = node->left;
+
+			if (l && release(l)) {
+				node->left = l->right;
+				l->right = node;
+				node = l;
+
+			} else {
+				node->left = nullptr;
+
+				avl_tree* r;
+				free_node(node, l, r);
+				node = r;
+			}
+		}
+	}
+
+	/**
+	 * @brief Libera um nó e as suas subárvores, sem recursão
+	 * 
+	 * Se outra árvore ainda aponta para um nó, ele só perde uma referência,
+	 * e as suas subárvores não são visitadas.
+	 */
+	static void delete_node(avl_tree* node) {
+		if (release(node))
+			delete_owned(node);
+	}
+
+	/**
+	 * @brief Libera uma subárvore cuja raiz só pertence a quem chamou
+	 * 
+	 * O percurso segue o galho com menos nós e guarda o outro numa pilha de
+	 * tamanho fixo. Como a subárvore seguida cai pelo menos à metade a cada
+	 * galho guardado, a pilha não passa de log2(n) galhos, qualquer que
+	 * seja a altura da árvore; só com contagens erradas ela encheria, e
+	 * então o galho é liberado por rotações.
+	 * 
+	 * @param node Raiz da subárvore
+	 */
+	static void delete_owned(avl_tree* node) {
+		avl_tree* stack[64];
+		int top = 0;
+
+		for (;;) {
+			avl_tree *l, *r;
+			free_node(node, l, r);
+
+			if (l && r) {
+				if (l->_size + l->_dead > r->_size + r->_dead)
+					std::swap(l, r);
+
+				if (top < 64)
+					stack[top++] = r;
+				else
+					delete_by_rotations(r);
+			}
+
+			node = l ? l : r;
+
+			if (!node) {
+				if (top == 0)
+					return;
+
+				node = stack[--top];
+			}
+		}
+	}
+
+	/**
+	 * @brief Compara duas informações em três vias
+	 * 
+	 * Com T aritmético e os comparadores padrão, o resultado sai de duas
+	 * comparações de valores, sem desvios; nos outros casos, de `equals` e
+	 * `less_than`.
+	 * 
+	 * @return int Negativo se `a` for menor, zero se forem iguais e
+	 *         positivo se `a` for maior
+	 */
+	static int compare(const cmp_t& cmp, const T& a, const T& b) {
+		return compare(cmp, a, b, native_compare_t());
+	}
+
+	static int compare(const cmp_t&, const T& a, const T& b, std::true_type) {
+		Stats::compared();
+		return (b < a) - (a < b);
+	}
+
+	static int compare(const cmp_t& cmp, const T& a, const T& b, std::false_type) {
+		return equals(cmp, a, b) ? 0 : less_than(cmp, a, b) ? -1 : 1;
+	}
+
+	/**
+	 * @brief Compara em três vias uma informação procurada com a de um nó,
+	 *        só lendo a do nó se o prefixo guardado nele não decidir
+	 * 
+	 * @param probe Sonda da informação procurada
+	 * @param node Informação do nó
+	 */
+	static int compare_to(
+		const cmp_t& cmp,
+		const T& data,
+		const probe_t& probe,
+		const info_ptr& node
+	) {
+		int order = storage_t::order(probe, node);
+
+		if (order != 0) {
+			Stats::compared();
+			return order;
+		}
+
+		return compare(cmp, data, *node);
+	}
+
+	/**
+	 * @brief Aloca uma cópia de uma informação, ou a guarda no nó
+	 */
+	static info_ptr new_info(const T& data) {
+		return new_info(data, inline_t());
+	}
+
+	static info_ptr new_info(const T& data, std::false_type) {
+		Stats::allocated();
+		return new T(data);
+	}
+
+	static info_ptr new_info(const T& data, std::true_type) {
+		return info_ptr(data);
+	}
+
+	/**
+	 * @brief Libera uma informação
+	 */
+	static void delete_info(info_ptr data) {
+		delete_info(data, inline_t());
+	}
+
+	static void delete_info(T* data, std::false_type) {
+		Stats::deallocated();
+		delete data;
+	}
+
+	static void delete_info(const info_ptr &, std::true_type) {}
+
+	/**
+	 * @brief Lista ligada de nós em ordem crescente, encadeada pelo
+	 *        ponteiro `right`, usada na construção em massa
+	 */
+	struct vine {
+		avl_tree* head;		//! Primeiro nó da lista
+		avl_tree* last;		//! Último nó da lista
+		int size;			//! Número de nós na lista
+		const cmp_t& cmp;	//! Comparadores da árvore
+
+		explicit vine(const cmp_t& cmp)
+			: head(nullptr), last(nullptr), size(0), cmp(cmp) {}
+
+		/**
+		 * @brief Destrutor, libera os nós que não foram usados
+		 */
+		~vine() {
+			while (head) {
+				avl_tree* next = head->right;
+				head->right = nullptr;
+				delete_node(head);
+				head = next;
+			}
+		}
+
+		/**
+		 * @brief Adiciona uma informação ao fim da lista
+		 *
+		 * @param data Informação, maior que todas as anteriores
+		 */
+		void push(const T& data) {
+			if (last && !less_than(cmp, *last->info, data))
+				throw "Unsorted sequence";
+
+			avl_tree* node = new_node();
+			node->info = new_info(data);
+
+			if (last)
+				last->right = node;
+			else
+				head = node;
+
+			last = node;
+			size++;
+		}
+
+		/**
+		 * @brief Adiciona um nó já alocado ao fim da lista
+		 *
+		 * @param node Nó sem galho à esquerda, maior que todos os anteriores
+		 */
+		void append(avl_tree* node) {
+			node->right = nullptr;
+
+			if (last)
+				last->right = node;
+			else
+				head = node;
+
+			last = node;
+			size++;
+		}
+	};
+
+	/**
+	 * @brief Monta uma árvore perfeitamente balanceada com os primeiros
+	 *        nós de uma lista, em tempo linear e sem realocá-los
+	 *
+	 * @param head Início da lista, avançado conforme os nós são usados
+	 * @param n Número de nós a consumir
+	 * @return avl_tree* Raiz da árvore montada
+	 */
+	static avl_tree* assemble(avl_tree* & head, int n) {
+		if (n == 0)
+			return nullptr;
+
+		int nl = (n - 1) / 2;
+		avl_tree* l = assemble(head, nl);
+
+		avl_tree* node = head;
+		head = head->right;
+
+		node->left = l;
+		node->right = assemble(head, n - 1 - nl);
+
+		int lh = node->left ? node->left->_height : 0,
+			rh = node->right ? node->right->_height : 0;
+
+		node->_height = (rh > lh ? rh : lh) + 1;
+		node->_size = n;
+		node->_dead = 0;
+		node->update_aggregate(augmented_t());
+
+		return node;
+	}
+
+	//! Menor subárvore dividida entre threads nos algoritmos paralelos
+	static const int PARALLEL_GRAIN = 1 << 14;
+
+	/**
+	 * @brief Monta uma árvore perfeitamente balanceada com um trecho de uma
+	 *        sequência ordenada, montando as duas metades em paralelo
+	 *
+	 * A metade esquerda é montada numa nova thread e a direita na thread
+	 * atual, cada uma com metade das threads, até que as subárvores fiquem
+	 * menores que `PARALLEL_GRAIN` ou acabem as threads. A árvore tem o
+	 * mesmo formato da montada por `assemble`.
+	 *
+	 * @param cmp Comparadores da árvore
+	 * @param base Início da sequência inteira
+	 * @param lo Índice do começo do trecho
+	 * @param hi Índice do fim do trecho
+	 * @param threads Número de threads disponíveis
+	 * @return avl_tree* Raiz da árvore montada
+	 */
+	template <class Iterator> static avl_tree* build_range(
+		const cmp_t& cmp,
+		Iterator base,
+		long lo,
+		long hi,
+		unsigned threads
+	) {
+		if (lo == hi)
+			return nullptr;
+
+		long mid = lo + (hi - lo - 1) / 2;
+
+		// Cada par de vizinhos é conferido uma vez, no nó do maior deles
+		if (mid > 0 && !less_than(cmp, base[mid - 1], base[mid]))
+			throw "Unsorted sequence";
+
+		avl_tree* node = new_node();
+
+		try {
+			node->info = new_info(base[mid]);
+
+			if (threads > 1 && hi - lo >= PARALLEL_GRAIN) {
+				std::future<avl_tree*> left = std::async(std::launch::async, [=] {
+					return build_range(cmp, base, lo, mid, threads / 2);
+				});
+
+				try {
+					node->right = build_range(cmp, base, mid + 1, hi, threads - threads / 2);
+
+				} catch (...) {
+					avl_tree* l = nullptr;
+
+					try {
+						l = left.get();
+					} catch (...) {}
+
+					if (l)
+						delete_node(l);
+
+					throw;
+				}
+
+				node->left = left.get();
+
+			} else {
+				node->left = build_range(cmp, base, lo, mid, 1);
+				node->right = build_range(cmp, base, mid + 1, hi, 1);
+			}
+
+		} catch (...) {
+			delete_node(node);
+			throw;
+		}
+
+		node->update_height();
+		node->update_size();
+
+		return node;
+	}
+
+	/**
+	 * @brief Percorre em ordem as informações vivas de uma subárvore, sem
+	 *        recursão
+	 *
+	 * @param t Raiz da subárvore, ou nullptr
+	 * @param fn Função chamada com cada informação
+	 */
+	template <class Function> static void walk(const avl_tree* t, Function& fn) {
+		std::vector<const avl_tree*> nodes;
+
+		for (;;) {
+			for (; t && t->_size > 0; t = t->left)
+				nodes.push_back(t);
+
+			if (nodes.empty())
+				return;
+
+			t = nodes.back();
+			nodes.pop_back();
+
+			if (!t->_tombstone)
+				fn(*t->info);
+
+			t = t->right;
+		}
+	}
+
+	/**
+	 * @brief Percorre as informações vivas de uma subárvore, dividindo as
+	 *        subárvores grandes entre threads
+	 *
+	 * @param t Raiz da subárvore, ou nullptr
+	 * @param fn Função chamada com cada informação
+	 * @param threads Número de threads disponíveis
+	 */
+	template <class Function> static void walk_parallel(
+		const avl_tree* t,
+		Function& fn,
+		unsigned threads
+	) {
+		if (!t || t->_size == 0)
+			return;
+
+		if (threads <= 1 || t->_size < PARALLEL_GRAIN) {
+			walk(t, fn);
+			return;
+		}
+
+		std::future<void> left = std::async(std::launch::async, [&] {
+			walk_parallel(t->left, fn, threads / 2);
+		});
+
+		if (!t->_tombstone)
+			fn(*t->info);
+
+		walk_parallel(t->right, fn, threads - threads / 2);
+		left.get();
+	}
+
+	/**
+	 * @brief Reduz as informações vivas de uma subárvore, em ordem,
+	 *        dividindo as subárvores grandes entre threads
+	 *
+	 * @param t Raiz da subárvore, ou nullptr
+	 * @param identity Valor neutro de `combine`
+	 * @param map Leva uma informação a um valor
+	 * @param combine Junta dois valores, em ordem
+	 * @param threads Número de threads disponíveis
+	 * @return U A combinação dos valores da subárvore
+	 */
+	template <class U, class Map, class Combine> static U reduce_parallel(
+		const avl_tree* t,
+		const U& identity,
+		Map& map,
+		Combine& combine,
+		unsigned threads
+	) {
+		if (!t || t->_size == 0)
+			return identity;
+
+		if (threads <= 1 || t->_size < PARALLEL_GRAIN) {
+			U acc = identity;
+			auto fold = [&](const T& data) { acc = combine(acc, map(data)); };
+
+			walk(t, fold);
+			return acc;
+		}
+
+		std::future<U> left = std::async(std::launch::async, [&] {
+			return reduce_parallel(t->left, identity, map, combine, threads / 2);
+		});
+
+		U right = reduce_parallel(t->right, identity, map, combine, threads - threads / 2);
+		U acc = left.get();
+
+		if (!t->_tombstone)
+			acc = combine(acc, map(*t->info));
+
+		return combine(acc, right);
+	}
+
+	/**
+	 * @brief Obtém o número de threads a usar, com 0 valendo o número de
+	 *        núcleos da máquina
+	 */
+	static unsigned thread_count(unsigned threads) {
+		if (threads == 0)
+			threads = std::thread::hardware_concurrency();
+
+		return threads > 0 ? threads : 1;
+	}
+
+	/**
+	 * @brief Lê um valor inteiro em decimal direto do buffer da stream,
+	 *        sem passar pela formatação da `std::istream`
+	 *
+	 * @param in Stream de entrada
+	 * @param data Valor lido
+	 * @return true se um valor válido foi lido
+	 * @return false caso contrário
+	 */
+	template <class U> static bool read_value(
+		std::istream & in,
+		U& data,
+		std::true_type
+	) {
+		typedef std::numeric_limits<U> limits;
+
+		std::streambuf* buf = in.rdbuf();
+		int c = buf->sgetc();
+		bool negative = c == '-';
+
+		if (c == '-' || c == '+')
+			c = buf->snextc();
+
+		unsigned long long max = negative
+			? (limits::is_signed ? (unsigned long long) limits::max() + 1 : 0)
+			: (unsigned long long) limits::max();
+		unsigned long long value = 0;
+		bool valid = std::isdigit(c);
+
+		for (; std::isdigit(c); c = buf->snextc()) {
+			unsigned digit = c - '0';
+
+			// Sem sinal, `max` é 0 com um '-', e a subtração daria a volta
+			if (digit > max || value > (max - digit) / 10)
+				valid = false;
+			else
+				value = value * 10 + digit;
+		}
+
+		if (!valid) {
+			in.setstate(std::ios::failbit);
+			return false;
+		}
+
+		data = negative ? (U) (0ull - value) : (U) value;
+		return true;
+	}
+
+	/**
+	 * @brief Lê um valor qualquer usando `operator >>`
+	 *
+	 * @param in Stream de entrada
+	 * @param data Valor lido
+	 * @return true se um valor válido foi lido
+	 * @return false caso contrário
+	 */
+	template <class U> static bool read_value(
+		std::istream & in,
+		U& data,
+		std::false_type
+	) {
+		return static_cast<bool>(in >> data);
+	}
+
+	/**
+	 * @brief Escritor de texto com buffer próprio, que formata números sem
+	 *        passar pela formatação da `std::ostream`
+	 */
+	class text_writer {
+	private:
+		std::ostream & out;		//! Stream de saída
+		char buf[1 << 14];		//! Buffer de saída
+		size_t n;				//! Bytes ocupados no buffer
+
+		/**
+		 * @brief Garante espaço livre no buffer
+		 */
+		void reserve(size_t bytes) {
+			if (n + bytes > sizeof buf)
+				flush();
+		}
+
+		/**
+		 * @brief Escreve um inteiro em decimal
+		 */
+		void write(const T& value, std::true_type, std::false_type) {
+			char digits[24];
+			char* end = digits + sizeof digits;
+			char* p = end;
+
+			bool negative = value < T();
+			unsigned long long v = negative
+				? 0ull - (unsigned long long) value
+				: (unsigned long long) value;
+
+			do {
+				*--p = '0' + v % 10;
+				v /= 10;
+			} while (v);
+
+			if (negative)
+				*--p = '-';
+
+			reserve(end - p);
+
+			for (; p != end; ++p)
+				buf[n++] = *p;
+		}
+
+		/**
+		 * @brief Escreve um número de ponto flutuante no formato que a
+		 *        `std::ostream` usaria, pela precisão e pelas flags dela
+		 */
+		void write(const T& value, std::false_type, std::true_type) {
+			std::ios::fmtflags flags = out.flags();
+			std::ios::fmtflags field = flags & std::ios::floatfield;
+			bool upper = flags & std::ios::uppercase;
+
+			// Hexadecimal fica com a stream
+			if (field == (std::ios::fixed | std::ios::scientific)) {
+				flush();
+				out << value;
+				return;
+			}
+
+			char format[8];
+			char* f = format;
+
+			*f++ = '%';
+
+			if (flags & std::ios::showpos)
+				*f++ = '+';
+
+			if (flags & std::ios::showpoint)
+				*f++ = '#';
+
+			*f++ = '.';
+			*f++ = '*';
+			*f++ = 'L';
+
+			if (field == std::ios::fixed)
+				*f++ = 'f';
+			else if (field == std::ios::scientific)
+				*f++ = upper ? 'E' : 'e';
+			else
+				*f++ = upper ? 'G' : 'g';
+
+			*f = '\0';
+
+			reserve(64);
+
+			size_t room = sizeof buf - n;
+			int len = std::snprintf(
+				buf + n, room, format, (int) out.precision(), (long double) value
+			);
+
+			// Grande demais para o buffer: fica com a stream
+			if (len < 0 || (size_t) len >= room) {
+				flush();
+				out << value;
+			} else {
+				n += len;
+			}
+		}
+
+		/**
+		 * @brief Escreve qualquer outro valor usando `operator <<`
+		 */
+		void write(const T& value, std::false_type, std::false_type) {
+			flush();
+			out << value;
+		}
+
+	public:
+
+		/**
+		 * @brief Construtor
+		 *
+		 * @param out Stream de saída
+		 */
+		explicit text_writer(std::ostream & out) : out(out), n(0) {}
+
+		/**
+		 * @brief Destrutor, descarrega o buffer
+		 */
+		~text_writer() {
+			flush();
+		}
+
+		/**
+		 * @brief Escreve um caractere
+		 */
+		void put(char c) {
+			reserve(1);
+			buf[n++] = c;
+		}
+
+		/**
+		 * @brief Escreve um valor
+		 */
+		void put(const T& value) {
+			write(value, decimal_t(), std::integral_constant<bool,
+				std::is_same<T, float>::value || std::is_same<T, double>::value
+			>());
+		}
+
+		/**
+		 * @brief Escreve o buffer na stream
+		 */
+		void flush() {
+			if (n > 0)
+				out.write(buf, n);
+
+			n = 0;
+		}
+	};
+
+	/**
+	 * @brief Substitui o conteúdo da árvore pelos nós de uma lista
+	 *
+	 * @param list Lista de nós em ordem crescente, esvaziada no processo
+	 */
+	void assemble(vine& list) {
+		avl_tree* head = list.head;
+		avl_tree* root = assemble(head, list.size);
+
+		list.head = list.last = nullptr;
+		list.size = 0;
+
+		clear();
+
+		if (root) {
+			swap_nodes(*this, *root);
+			delete_node(root);
+		}
+	}
+
+	/**
+	 * @brief Desliga o maior nó da árvore, sem copiar a informação
+	 * 
+	 * @param dead Recebe se a informação desligada era uma lápide
+	 * @return info_ptr A informação do nó desligado
+	 */
+	info_ptr detach_max(bool& dead) {
+		Stats::visited();
+
+		info_ptr aux;
+
+		if (right) {
+			aux = own(right)->detach_max(dead);
+			delete_if_empty(right);
+
+		} else {
+			aux = info;
+			dead = _tombstone;
+			info = nullptr;
+			_tombstone = false;
+			splice(left);
+		}
+
+		recalculate(false);
+
+		return aux;
+	}
+
+	/**
+	 * @brief Desliga o menor nó da árvore, sem copiar a informação
+	 * 
+	 * @param dead Recebe se a informação desligada era uma lápide
+	 * @return info_ptr A informação do nó desligado
+	 */
+	info_ptr detach_min(bool& dead) {
+		Stats::visited();
+
+		info_ptr aux;
+
+		if (left) {
+			aux = own(left)->detach_min(dead);
+			delete_if_empty(left);
+
+		} else {
+			aux = info;
+			dead = _tombstone;
+			info = nullptr;
+			_tombstone = false;
+			splice(right);
+		}
+
+		recalculate(false);
+
+		return aux;
+	}
+
+	/**
+	 * @brief Descarta a informação deste nó e põe no lugar dela a sua
+	 *        antecessora ou sucessora, desligando o nó de onde ela veio
+	 */
+	void unlink() {
+		delete_info(info);
+
+		if (left) {
+			info = own(left)->detach_max(_tombstone);
+			delete_if_empty(left);
+
+		} else if (right) {
+			info = own(right)->detach_min(_tombstone);
+			delete_if_empty(right);
+
+		} else {
+			info = nullptr;
+			_tombstone = false;
+		}
+	}
+
+	/**
+	 * @brief Marca uma informação como removida, sem reestruturar a árvore
+	 * 
+	 * @param cmp Comparadores da árvore
+	 * @param data Informação a ser marcada
+	 */
+	void bury(const cmp_t& cmp, const T& data) {
+		Stats::visited();
+
+		if (empty())
+			throw "Information not found";
+
+		if (equals(cmp, *info, data)) {
+			if (_tombstone)
+				throw "Information not found";
+
+			_tombstone = true;
+
+		} else if (less_than(cmp, data, *info)) {
+			if (!left)
+				throw "Information not found";
+
+			own(left)->bury(cmp, data);
+
+		} else {
+			if (!right)
+				throw "Information not found";
+
+			own(right)->bury(cmp, data);
+		}
+
+		update_size();
+	}
+
+	/**
+	 * @brief Remove de fato a lápide mais à esquerda da árvore
+	 */
+	void purge_one() {
+		Stats::visited();
+
+		if (left && left->_dead > 0) {
+			own(left)->purge_one();
+			delete_if_empty(left);
+
+		} else if (_tombstone) {
+			unlink();
+
+		} else {
+			own(right)->purge_one();
+			delete_if_empty(right);
+		}
+
+		recalculate(false);
+	}
+
+	/**
+	 * @brief Desliga o maior nó de uma subárvore, religando os ponteiros em
+	 *        vez de copiar ou liberar nós
+	 * 
+	 * @param t Ponteiro para a subárvore, que recebe a nova raiz dela
+	 * @return avl_tree* O nó desligado, sem galhos
+	 */
+	static avl_tree* unlink_max(avl_tree* & t) {
+		Stats::visited();
+		own(t);
+
+		if (t->right) {
+			avl_tree* node = unlink_max(t->right);
+			t->recalculate(false);
+			return node;
+		}
+
+		avl_tree* node = t;
+		t = node->left;
+		node->left = nullptr;
+
+		return node;
+	}
+
+	/**
+	 * @brief Desliga o menor nó de uma subárvore, religando os ponteiros em
+	 *        vez de copiar ou liberar nós
+	 * 
+	 * @param t Ponteiro para a subárvore, que recebe a nova raiz dela
+	 * @return avl_tree* O nó desligado, sem galhos
+	 */
+	static avl_tree* unlink_min(avl_tree* & t) {
+		Stats::visited();
+		own(t);
+
+		if (t->left) {
+			avl_tree* node = unlink_min(t->left);
+			t->recalculate(false);
+			return node;
+		}
+
+		avl_tree* node = t;
+		t = node->right;
+		node->right = nullptr;
+
+		return node;
+	}
+
+	/**
+	 * @brief Desliga o menor ou o maior nó da árvore, mesmo que seja uma
+	 *        lápide
+	 * 
+	 * Se a ponta for a raiz, que é o próprio objeto, a informação dela
+	 * troca de nó com a vizinha; o nó só é alocado se a raiz for uma folha.
+	 * 
+	 * @param max Se desliga o maior nó, em vez do menor
+	 * @return avl_tree* O nó desligado, sem galhos
+	 */
+	avl_tree* unlink_end(bool max) {
+		avl_tree* node;
+
+		if (max ? right : left) {
+			node = max ? unlink_max(right) : unlink_min(left);
+
+		} else {
+			if (is_leaf())
+				node = new_node();
+			else
+				node = max ? unlink_max(left) : unlink_min(right);
+
+			std::swap(info, node->info);
+			std::swap(_tombstone, node->_tombstone);
+		}
+
+		recalculate(false);
+
+		node->_height = 1;
+		node->update_size();
+
+		return node;
+	}
+
+	/**
+	 * @brief Obtém a primeira informação viva, guardada no agregado
+	 */
+	const T& first_info(std::true_type) const {
+		return Augment::front(this->_aggregate);
+	}
+
+	/**
+	 * @brief Obtém a primeira informação viva, descendo sem recursão
+	 */
+	const T& first_info(std::false_type) const {
+		const avl_tree* t = this;
+
+		for (;;) {
+			if (t->left && t->left->_size > 0)
+				t = t->left;
+			else if (!t->_tombstone)
+				return *t->info;
+			else
+				t = t->right;
+		}
+	}
+
+	/**
+	 * @brief Obtém a última informação viva, guardada no agregado
+	 */
+	const T& last_info(std::true_type) const {
+		return Augment::back(this->_aggregate);
+	}
+
+	/**
+	 * @brief Obtém a última informação viva, descendo sem recursão
+	 */
+	const T& last_info(std::false_type) const {
+		const avl_tree* t = this;
+
+		for (;;) {
+			if (t->right && t->right->_size > 0)
+				t = t->right;
+			else if (!t->_tombstone)
+				return *t->info;
+			else
+				t = t->left;
+		}
+	}
+
+	/**
+	 * @brief Desliga da árvore o nó de uma informação, sem copiar nem
+	 *        liberar nada
+	 * 
+	 * Se o nó tiver galhos, a informação dele é trocada com a do nó
+	 * antecessor ou sucessor, que é o nó desligado. Se o nó for uma folha,
+	 * ele mesmo é retornado, e cabe a quem chamou desligá-lo.
+	 * 
+	 * @param cmp Comparadores da árvore
+	 * @param data Informação procurada
+	 * @return avl_tree* O nó desligado, sem galhos
+	 */
+	avl_tree* extract_node(const cmp_t& cmp, const T& data) {
+		Stats::visited();
+
+		if (empty())
+			throw "Information not found";
+
+		avl_tree* node;
+		int order = compare_to(cmp, data, storage_t::probe(data), info);
+
+		if (order == 0) {
+			if (_tombstone)
+				throw "Information not found";
+
+			if (is_leaf())
+				return this;
+
+			node = left ? unlink_max(left) : unlink_min(right);
+
+			std::swap(info, node->info);
+			std::swap(_tombstone, node->_tombstone);
+
+		} else if (order < 0) {
+			if (!left)
+				throw "Information not found";
+
+			node = own(left)->extract_node(cmp, data);
+
+			if (node == left)
+				left = nullptr;
+
+		} else {
+			if (!right)
+				throw "Information not found";
+
+			node = own(right)->extract_node(cmp, data);
+
+			if (node == right)
+				right = nullptr;
+		}
+
+		recalculate(false);
+
+		return node;
+	}
+
+	/**
+	 * @brief Liga um nó desligado à árvore, sem copiar a informação dele
+	 * 
+	 * @param cmp Comparadores da árvore
+	 * @param node Nó sem galhos, com uma informação viva
+	 */
+	void link(const cmp_t& cmp, avl_tree* node) {
+		Stats::visited();
+
+		int order = info == nullptr ? 0 : compare_to(cmp, *node->info, storage_t::probe(*node->info), info);
+
+		if (info == nullptr) {
+			// A raiz é o próprio objeto, então só a informação é aproveitada
+			std::swap(info, node->info);
+			delete_node(node);
+			_height = 1;
+
+		} else if (order == 0) {
+			if (!_tombstone)
+				throw "Repeated information";
+
+			// Reaproveita a lápide; a informação antiga sai com o nó
+			std::swap(info, node->info);
+			_tombstone = false;
+			delete_node(node);
+
+		} else {
+			avl_tree* & child = order < 0 ? left : right;
+
+			if (child) {
+				own(child)->link(cmp, node);
+			} else {
+				node->_height = 1;
+				node->update_size();
+				child = node;
+			}
+		}
+
+		recalculate(true);
+	}
+
+	/**
+	 * @brief Divide uma árvore em duas pela posição de uma informação
+	 * 
+	 * Cada nó do caminho de busca é juntado, com `Balance::join`, ao lado
+	 * a que pertence, então o custo total é O(log n).
+	 * 
+	 * @param cmp Comparadores da árvore
+	 * @param t Raiz da árvore, fora do objeto raiz, ou nullptr
+	 * @param key Informação que separa os dois lados
+	 * @param inclusive Se as informações iguais a `key` vão para a esquerda
+	 * @param l Recebe a árvore das informações menores
+	 * @param r Recebe a árvore das informações maiores
+	 */
+	static void split(
+		const cmp_t& cmp,
+		avl_tree* t,
+		const T& key,
+		bool inclusive,
+		avl_tree* & l,
+		avl_tree* & r
+	) {
+		if (!t) {
+			l = r = nullptr;
+			return;
+		}
+
+		Stats::visited();
+		own(t);
+
+		avl_tree* tl = t->left;
+		avl_tree* tr = t->right;
+		t->left = t->right = nullptr;
+
+		bool goes_left = inclusive
+			? !less_than(cmp, key, *t->info)
+			: less_than(cmp, *t->info, key);
+
+		if (goes_left) {
+			avl_tree* rest;
+			split(cmp, tr, key, inclusive, rest, r);
+			l = Balance::join(tl, t, rest);
+
+		} else {
+			avl_tree* rest;
+			split(cmp, tl, key, inclusive, l, rest);
+			r = Balance::join(rest, t, tr);
+		}
+	}
+
+	/**
+	 * @brief Junta duas árvores, sem nó entre elas
+	 * 
+	 * @param l Árvore com as informações menores, ou nullptr
+	 * @param r Árvore com as informações maiores, ou nullptr
+	 * @return avl_tree* Raiz da árvore juntada
+	 */
+	static avl_tree* concat(avl_tree* l, avl_tree* r) {
+		if (!l)
+			return r;
+
+		if (!r)
+			return l;
+
+		// O menor nó da direita vira o nó do meio
+		avl_tree* m = new_node();
+		m->info = own(r)->detach_min(m->_tombstone);
+
+		if (r->empty()) {
+			delete_node(r);
+			r = nullptr;
+		}
+
+		return Balance::join(l, m, r);
+	}
+
+	/**
+	 * @brief Desliga da árvore as informações num intervalo, por divisão e
+	 *        junção
+	 * 
+	 * @param lo Menor informação do intervalo, inclusive
+	 * @param hi Maior informação do intervalo, inclusive
+	 * @return avl_tree* Árvore das informações desligadas, ou nullptr
+	 */
+	avl_tree* cut_range(const T& lo, const T& hi, std::true_type) {
+		const cmp_t& cmp = *this;
+
+		if (empty() || less_than(cmp, hi, lo))
+			return nullptr;
+
+		// A raiz é o próprio objeto; os nós são todos movidos para o heap
+		avl_tree* t = new_node();
+		swap_nodes(*this, *t);
+
+		avl_tree *l, *m, *r, *rest;
+		split(*this, t, lo, false, l, rest);
+		split(*this, rest, hi, true, m, r);
+
+		avl_tree* root = concat(l, r);
+
+		if (root) {
+			swap_nodes(*this, *root);
+			delete_node(root);
+		}
+
+		return m;
+	}
+
+	/**
+	 * @brief Remove da árvore as informações num intervalo, uma a uma, para
+	 *        políticas de balanceamento que não juntam árvores
+	 * 
+	 * As lápides do intervalo ficam na árvore.
+	 * 
+	 * @param lo Menor informação do intervalo, inclusive
+	 * @param hi Maior informação do intervalo, inclusive
+	 * @return avl_tree* Árvore das informações removidas, ou nullptr
+	 */
+	avl_tree* cut_range(const T& lo, const T& hi, std::false_type) {
+		const cmp_t& cmp = *this;
+		std::vector<T> found;
+		std::vector<const avl_tree*> nodes;
+		const avl_tree* t = empty() ? nullptr : this;
+
+		for (;;) {
+			while (t) {
+				if (less_than(cmp, *t->info, lo)) {
+					t = t->right;
+				} else {
+					nodes.push_back(t);
+					t = t->left;
+				}
+			}
+
+			if (nodes.empty())
+				break;
+
+			t = nodes.back();
+			nodes.pop_back();
+
+			if (less_than(cmp, hi, *t->info))
+				break;
+
+			if (!t->_tombstone)
+				found.push_back(*t->info);
+
+			t = t->right;
+		}
+
+		if (found.empty())
+			return nullptr;
+
+		for (const T& data : found)
+			remove(data);
+
+		avl_tree removed(node_tag(), *this);
+		removed.build(found.begin(), found.end());
+
+		avl_tree* m = new_node();
+		swap_nodes(*m, removed);
+
+		return m;
+	}
+
+	/**
+	 * @brief Insere uma informação na subárvore
+	 *
+	 * @param cmp Comparadores da árvore
+	 * @param data Dados a serem inseridos
+	 */
+	void insert(const cmp_t& cmp, T data) {
+		typename Stats::scope scope(AVL_INSERT);
+		Stats::visited();
+
+		int order = info == nullptr ? 0 : compare_to(cmp, data, storage_t::probe(data), info);
+
+		if (info == nullptr) {
+			info = new_info(data);
+			_height = 1;
+
+		} else if (order == 0) {
+			if (!_tombstone)
+				throw "Repeated information";
+
+			// Reaproveita a lápide
+			*info = data;
+			_tombstone = false;
+
+		} else if (order < 0) {
+			if (left == nullptr)
+				left = new_node();
+
+			own(left)->insert(cmp, data);
+
+		} else {
+			if (right == nullptr)
+				right = new_node();
+
+			own(right)->insert(cmp, data);
+		}
+
+		recalculate(true);
+	}
+
+	/**
+	 * @brief Atualiza uma informação na subárvore
+	 * 
+	 * @param cmp Comparadores da árvore
+	 * @param data Dados a serem atualizados
+	 */
+	void update(const cmp_t& cmp, const T& data) {
+		typename Stats::scope scope(AVL_UPDATE);
+		Stats::visited();
+
+		int order = info == nullptr ? 0 : compare_to(cmp, data, storage_t::probe(data), info);
+
+		if (info == nullptr) {
+			insert(cmp, data);
+
+		} else if (order == 0) {
+			*info = data;
+			_tombstone = false;
+
+		} else if (order < 0) {
+			if (left == nullptr)
+				insert(cmp, data);
+			else
+				own(left)->update(cmp, data);
+
+		} else {
+			if (right == nullptr)
+				insert(cmp, data);
+			else
+				own(right)->update(cmp, data);
+		}
+
+		recalculate(true);
+	}
+
+	/**
+	 * @brief Remove uma informação da subárvore
+	 * 
+	 * @param cmp Comparadores da árvore
+	 * @param data Informação a ser removida
+	 */
+	void remove(const cmp_t& cmp, const T & data) {
+		typename Stats::scope scope(AVL_REMOVE);
+		Stats::visited();
+
+		if (empty())
+			throw "Can't remove from empty tree";
+
+		int order = compare_to(cmp, data, storage_t::probe(data), info);
+
+		if (order == 0) {
+			if (_tombstone)
+				throw "Information not found";
+
+			unlink();
+
+		} else if (order < 0) {
+			if (!left)
+				throw "Information not found";
+
+			own(left)->remove(cmp, data);
+			delete_if_empty(left);
+
+		} else {
+			if (!right)
+				throw "Information not found";
+
+			own(right)->remove(cmp, data);
+			delete_if_empty(right);
+		}
+
+		recalculate(false);
+	}
+
+public:
+
+	/**
+	 * @brief Construtor
+	 */
+	avl_tree() : avl_tree(Compare()) {}
+
+	/**
+	 * @brief Construtor, com comparadores que podem ter estado, como uma
+	 *        tabela de ordenação
+	 * 
+	 * Os comparadores não precisam ser construíveis por padrão: os nós
+	 * criados pela árvore não guardam cópias deles.
+	 * 
+	 * @param is_less Comparador de ordem
+	 * @param is_equal Comparador de igualdade
+	 */
+	explicit avl_tree(const Compare& is_less, const Equal& is_equal = Equal())
+		: avl_tree(node_tag(), cmp_t(is_less, is_equal)) {}
+	
+	/**
+	 * @brief Destrutor
+	 */
+	~avl_tree() {
+		if (info)
+			delete_info(info);
+
+		if (left)
+			delete_node(left);
+
+		if (right)
+			delete_node(right);
+	}
+
+	/**
+	 * @brief Construtor de cópia, em O(1)
+	 * 
+	 * Só a informação da raiz, que fica no próprio objeto, é copiada; as
+	 * subárvores passam a ser compartilhadas com o modelo. Cada nó é
+	 * copiado depois, e só uma vez, quando uma das árvores alterar o
+	 * caminho que passa por ele. As duas árvores continuam independentes,
+	 * e podem ser alteradas em threads diferentes.
+	 */
+	avl_tree(const avl_tree & model)
+		: slot_t(model), cmp_t(model),
+		  info(model.info ? new_info(*model.info) : info_ptr()),
+		  left(share(model.left)), right(share(model.right)),
+		  _size(model._size), _dead(model._dead), _height(model._height),
+		  _tombstone(model._tombstone), _shares(0) {}
+	
+	/**
+	 * @brief Operador de cópia, em O(1), como o construtor de cópia
+	 * 
+	 * @param model Objeto modelo
+	 * @return avl_tree& Cópia do objeto modelo
+	 */
+	avl_tree & operator = (const avl_tree & model) {
+		if (this != & model) {
+			avl_tree copy(model);
+			swap(*this, copy);
+		}
+
+		return *this;
+	}
+	
+	/**
+	 * @brief Construtor de movimento, sem copiar os nós
+	 * 
+	 * O modelo fica vazio, com os mesmos comparadores.
+	 */
+	avl_tree(avl_tree && model) : avl_tree(node_tag(), model) {
+		swap_nodes(*this, model);
+	}
+
+	/**
+	 * @brief Operador de movimento, sem copiar os nós
+	 * 
+	 * @param model Objeto modelo, que fica com o conteúdo antigo deste
+	 * @return avl_tree& Este objeto
+	 */
+	avl_tree & operator = (avl_tree && model) {
+		swap(*this, model);
+		return *this;
+	}
+
+	/**
+	 * @brief Operador de swap
+	 * 
+	 * @param first Primeiro objeto
+	 * @param other Outro objeto
+	 */
+	friend void swap(avl_tree & first, avl_tree & other) {
+		using std::swap;
+
+		swap_nodes(first, other);
+		swap(static_cast<cmp_t&>(first), static_cast<cmp_t&>(other));
+	}
+
+	/**
+	 * @brief Obtém o comparador de ordem da árvore
+	 */
+	using cmp_t::key_comp;
+
+	/**
+	 * @brief Obtém o comparador de igualdade da árvore
+	 */
+	using cmp_t::key_eq;
+	
+	/**
+	 * @brief Obtém a altura da árvore
+	 * 
+	 * @return int a altura da árvore
+	 */
+	int height() const {
+		return _height;
+	}
+	
+	/**
+	 * @brief Obtém a quantidade de elementos da árvore
+	 * 
+	 * @return int a quantidade de elementos da árvore
+	 */
+	int size() const {
+		return _size;
+	}
+
+	/**
+	 * @brief Determina se a árvore é uma folha
+	 * 
+	 * @return true se a árvore for uma folha
+	 * @return false caso contrário
+	 */
+	bool is_leaf() const {
+		return left == nullptr && right == nullptr;
+	}
+
+	/**
+	 * @brief Determina se a árvore está vazia
+	 * 
+	 * Lápides ainda não compactadas contam como nós: uma árvore só com
+	 * lápides tem tamanho 0, mas não está vazia.
+	 * 
+	 * @return true se a árvore não tiver nenhum elemento ou nó filho
+	 * @return false caso contrário
+	 */
+	bool empty() const {
+		return info == nullptr;
+	}
+	
+	/**
+	 * @brief Obtém o menor valor da árvore
+	 * 
+	 * Custa O(1) com o aumento `avl_bounds`, e O(log n) sem ele.
+	 * 
+	 * @return T Menor valor contido na árvore
+	 */
+	T min() const {
+		if (_size == 0)
+			throw "Empty tree has no minimum value";
 
-	T* info;			//! Informação do nó
-	avl_tree* left;		//! Nó à esquerda
-	avl_tree* right;	//! Nó à direita
+		return first_info(bounded_t());
+	}
 
-	int _size;			//! Número de elementos na árvore
-	int _height;		//! Altura da árvore
+	/**
+	 * @brief Obtém o maior valor da árvore
+	 * 
+	 * Custa O(1) com o aumento `avl_bounds`, e O(log n) sem ele.
+	 * 
+	 * @return T Maior valor contido na árvore
+	 */
+	T max() const {
+		if (_size == 0)
+			throw "Empty tree has no maximum value";
 
+		return last_info(bounded_t());
+	}
+	
 	/**
-	 * @brief Calcula o fator de balanceamento da árvore
+	 * @brief Remove o maior valor da árvore e retorna
 	 * 
-	 * @return int o fator de balanceamento do nó
+	 * @return T Maior valor contido na árvore
 	 */
-	int balance_factor() const {
-		return (right ? right->height() : 0) - (left ? left->height() : 0);
+	T pop() {
+		typename Stats::scope scope(AVL_POP);
+
+		if (_size == 0)
+			throw "Can't pop from an empty tree";
+
+		// As lápides encontradas no caminho são descartadas
+		for (;;) {
+			bool dead;
+			info_ptr data = detach_max(dead);
+
+			if (!dead) {
+				T aux(std::move(*data));
+				delete_info(data);
+				self_check();
+				return aux;
+			}
+
+			delete_info(data);
+		}
 	}
 
 	/**
-	 * @brief Libera a memória de um galho e apaga ele, caso esteja vazio
+	 * @brief Remove o menor valor da árvore e retorna
 	 * 
-	 * @param ptr Referência de ponteiro do galho
+	 * @return T Menor valor contido na árvore
 	 */
-	inline void delete_if_empty(avl_tree* & ptr) {
-		if (!ptr)
-			return;
+	T popleft() {
+		typename Stats::scope scope(AVL_POPLEFT);
 
-		if (ptr->empty()) {
-			delete ptr;
-			ptr = nullptr;
+		if (_size == 0)
+			throw "Can't pop from an empty tree";
+
+		// As lápides encontradas no caminho são descartadas
+		for (;;) {
+			bool dead;
+			info_ptr data = detach_min(dead);
+
+			if (!dead) {
+				T aux(std::move(*data));
+				delete_info(data);
+				self_check();
+				return aux;
+			}
+
+			delete_info(data);
 		}
 	}
 
 	/**
-	 * @brief Rotação à esquerda
+	 * @brief Remove todas as informações da árvore
+	 * 
+	 * Os nós são liberados na hora, sem recursão. Para não pagar a
+	 * liberação de uma árvore grande de uma vez, use `clear(reclaimer&)`.
 	 */
-	void rotate_left() {
-		using std::swap;
+	void clear() {
+		avl_tree old((node_tag()));
+		swap_nodes(*this, old);
 
-		avl_tree* aux = this->right;
+		self_check();
+	}
 
-		this->_height -= 2;
-		aux->_height++;
+	/**
+	 * @brief Remove todas as informações da árvore em O(1), passando os nós
+	 *        para serem liberados depois
+	 * 
+	 * @param garbage Recebe os nós, que libera com `reclaim`
+	 */
+	void clear(reclaimer & garbage) {
+		if (info)
+			delete_info(info);
 
-		swap(this->_size, aux->_size);
+		garbage.push(left);
+		garbage.push(right);
 
-		this->right = aux->left;
+		info = nullptr;
+		left = right = nullptr;
+		_height = 0;
+		_size = 0;
+		_dead = 0;
+		_tombstone = false;
 
-		swap(*this, *aux);
-		this->left = aux;
+		update_aggregate(augmented_t());
+		self_check();
 	}
 
 	/**
-	 * @brief Rotação à direita
+	 * @brief Substitui o conteúdo da árvore por uma sequência ordenada, em
+	 *        tempo linear
+	 *
+	 * @param first Início da sequência, em ordem estritamente crescente
+	 * @param last Fim da sequência
 	 */
-	void rotate_right() {
-		using std::swap;
+	template <class Iterator> void build(Iterator first, Iterator last) {
+		vine list(*this);
 
-		avl_tree* aux = this->left;
-		
-		this->_height -= 2;
-		aux->_height++;
-		
-		swap(this->_size, aux->_size);
-
-		this->left = aux->right;
+		for (; first != last; ++first)
+			list.push(*first);
 
-		swap(*this, *aux);
-		this->right = aux;
+		assemble(list);
+		self_check();
 	}
 
 	/**
-	 * @brief Ajusta a árvore de forma a recuperar o balanceamento
+	 * @brief Substitui o conteúdo da árvore por uma sequência ordenada,
+	 *        montando as subárvores em paralelo
+	 *
+	 * As duas metades de cada subárvore são montadas em threads diferentes,
+	 * num fork-join recursivo, até que as subárvores fiquem pequenas demais
+	 * para compensar uma nova thread. A cópia das informações e a
+	 * verificação da ordem também são divididas entre as threads. Se a
+	 * sequência não estiver ordenada, a árvore não é alterada.
+	 *
+	 * @param first Início da sequência, de acesso aleatório e em ordem
+	 *        estritamente crescente
+	 * @param last Fim da sequência
+	 * @param threads Número máximo de threads (0 para o número de núcleos)
 	 */
-	void rebalance() {
-		int balance = balance_factor();
+	template <class Iterator> void build_parallel(
+		Iterator first,
+		Iterator last,
+		unsigned threads = 0
+	) {
+		avl_tree* root = build_range(*this, first, 0, last - first, thread_count(threads));
 
-		if (balance < -1) {
-			if (left->balance_factor() > 0)
-				left->rotate_left();
-			
-			rotate_right();
-		} else if (balance > 1) {
-			if (right->balance_factor() < 0)
-				right->rotate_right();
-				
-			rotate_left();
+		clear();
+
+		if (root) {
+			swap_nodes(*this, *root);
+			delete_node(root);
 		}
+
+		self_check();
 	}
 
 	/**
-	 * @brief Recalcula a altura da árvore e balanceia de necessário
+	 * @brief Chama uma função com cada informação da árvore, dividindo a
+	 *        árvore entre threads
+	 *
+	 * As subárvores são divididas pelo número de elementos, então cada
+	 * thread recebe uma parte parecida do trabalho. A função é chamada em
+	 * paralelo e sem ordem definida, e não pode alterar a árvore.
+	 *
+	 * @param fn Função chamada com cada informação
+	 * @param threads Número máximo de threads (0 para o número de núcleos)
 	 */
-	void recalculate() {
-		int rh = right ? right->_height : 0,
-			lh = left ? left->_height : 0;
-
-		_height = (rh > lh ? rh : lh) + 1;
+	template <class Function> void parallel_for_each(
+		Function fn,
+		unsigned threads = 0
+	) const {
+		walk_parallel(empty() ? nullptr : this, fn, thread_count(threads));
+	}
 
-		rebalance();
+	/**
+	 * @brief Reduz as informações da árvore, dividindo a árvore entre
+	 *        threads
+	 *
+	 * Cada thread reduz uma subárvore em ordem, e os resultados são
+	 * combinados também em ordem, então `combine` só precisa ser
+	 * associativa. `map` e `combine` são chamadas em paralelo.
+	 *
+	 * @param identity Valor neutro de `combine`
+	 * @param map Leva uma informação a um valor
+	 * @param combine Junta dois valores, em ordem
+	 * @param threads Número máximo de threads (0 para o número de núcleos)
+	 * @return U A combinação dos valores de todas as informações, em ordem
+	 */
+	template <class U, class Map, class Combine> U parallel_reduce(
+		const U& identity,
+		Map map,
+		Combine combine,
+		unsigned threads = 0
+	) const {
+		return reduce_parallel(
+			empty() ? nullptr : this, identity, map, combine, thread_count(threads)
+		);
 	}
 
 	/**
-	 * @brief Clona um ponteiro
+	 * @brief Lê uma árvore no formato escrito por `operator <<`
+	 *
+	 * Os elementos são lidos numa única passada e a árvore é remontada em
+	 * tempo linear. Se a entrada for inválida, a árvore não é alterada.
+	 *
+	 * @param in Stream de entrada
 	 */
-	template <class ptrT> inline ptrT* clone_ptr(ptrT* ptr) {
-		return ptr ? new ptrT(*ptr) : nullptr;
+	void load_text(std::istream & in) {
+		typedef std::char_traits<char> traits;
+
+		std::streambuf* buf = in.rdbuf();
+		vine list(*this);
+		int depth = 0;
+
+		do {
+			int c = buf->sgetc();
+
+			while (c != traits::eof() && std::isspace(c))
+				c = buf->snextc();
+
+			if (c == traits::eof()) {
+				in.setstate(std::ios::eofbit | std::ios::failbit);
+				throw "Unexpected end of tree text";
+			}
+
+			if (c == '(') {
+				buf->sbumpc();
+				depth++;
+
+			} else if (depth == 0) {
+				in.setstate(std::ios::failbit);
+				throw "Malformed tree text";
+
+			} else if (c == ')') {
+				buf->sbumpc();
+				depth--;
+
+			} else {
+				T data;
+				if (!read_value(in, data, decimal_t()))
+					throw "Malformed tree text";
+
+				list.push(data);
+			}
+		} while (depth > 0);
+
+		assemble(list);
+		self_check();
 	}
 
-public:
+	/**
+	 * @brief Insere uma informação na árvore
+	 *
+	 * @param data Dados a serem inseridos na árvore
+	 */
+	void insert(T data) {
+		insert(*this, data);
+		self_check();
+	}
+	
+	/**
+	 * @brief Atualiza uma informação na árvore
+	 * 
+	 * @param data Dados a serem atualizados na árvore
+	 */
+	void update(const T& data) {
+		update(*this, data);
+		self_check();
+	}
 
 	/**
-	 * @brief Construtor
+	 * @brief Remove uma informação da árvore
+	 * 
+	 * @param data Informação a ser removida
 	 */
-	avl_tree() {
-		info = nullptr;
-		left = nullptr;
-		right = nullptr;
-		_height = 0;
-		_size = 0;
+	void remove(const T & data) {
+		remove(*this, data);
+		self_check();
 	}
 	
 	/**
-	 * @brief Destrutor
+	 * @brief Remove uma informação da árvore só marcando o nó como lápide,
+	 *        sem rotações
+	 * 
+	 * Buscas e iteradores ignoram as lápides, e `size()` só conta os
+	 * elementos vivos. Quando as lápides passam da proporção dada, cada
+	 * chamada também remove de fato algumas delas, com `compact(int)`, de
+	 * forma que o trabalho de reestruturação fica limitado por chamada.
+	 * 
+	 * @param data Informação a ser removida
+	 * @param max_dead_ratio Proporção de lápides entre os nós a partir da
+	 *        qual a compactação incremental começa
 	 */
-	~avl_tree() {
-		if (info)
-			delete info;
+	void lazy_remove(const T& data, double max_dead_ratio = 0.25) {
+		typename Stats::scope scope(AVL_REMOVE);
 
-		if (left)
-			delete left;
+		bury(*this, data);
 
-		if (right)
-			delete right;
+		if (_dead > max_dead_ratio * (_size + _dead))
+			compact(2);
+
+		self_check();
 	}
 
 	/**
-	 * @brief Construtor de cópia
+	 * @brief Obtém o número de lápides da árvore
+	 * 
+	 * @return int o número de nós removidos ainda não compactados
 	 */
-	avl_tree(const avl_tree & model) {
-		*this = model;
+	int tombstones() const {
+		return _dead;
 	}
-	
+
+	/**
+	 * @brief Remove de fato todas as lápides, remontando a árvore em tempo
+	 *        linear e sem realocar os nós vivos
+	 */
+	void compact() {
+		if (_dead == 0)
+			return;
+
+		// A raiz é o próprio objeto; os nós são todos movidos para o heap
+		avl_tree* t = new_node();
+		swap_nodes(*this, *t);
+
+		std::vector<avl_tree*> stack;
+		vine list(*this);
+
+		// Os nós compartilhados com cópias da árvore são copiados antes de
+		// serem desmontados
+		while (t || !stack.empty()) {
+			for (; t; t = t->left)
+				stack.push_back(own(t));
+
+			t = stack.back();
+			stack.pop_back();
+
+			avl_tree* next = t->right;
+			t->left = t->right = nullptr;
+
+			if (t->_tombstone)
+				delete_node(t);
+			else
+				list.append(t);
+
+			t = next;
+		}
+
+		assemble(list);
+		self_check();
+	}
+
 	/**
-	 * @brief Operador de cópia
+	 * @brief Remove de fato algumas lápides, com o trabalho limitado
 	 * 
-	 * @param model Objeto modelo
-	 * @return avl_tree& Cópia do objeto modelo
+	 * @param budget Número máximo de lápides removidas
+	 * @return int O número de lápides que restaram
 	 */
-	avl_tree & operator = (const avl_tree & model) {
-		if (this == & model)
+	int compact(int budget) {
+		for (; budget > 0 && _dead > 0; budget--)
+			purge_one();
+
+		self_check();
+		return _dead;
+	}
+
+	/**
+	 * @brief Remove todas as informações num intervalo
+	 * 
+	 * A árvore é dividida nas pontas do intervalo e os dois lados de fora
+	 * são juntados de novo, então só os caminhos das pontas são
+	 * rebalanceados e o custo é O(log n + k), em que k é o número de nós
+	 * removidos. Com políticas de balanceamento que não juntam árvores,
+	 * como `avl_weak_balance`, as informações são removidas uma a uma, em
+	 * O(k log n).
+	 * 
+	 * @param lo Menor informação do intervalo, inclusive
+	 * @param hi Maior informação do intervalo, inclusive
+	 * @return int O número de informações removidas
+	 */
+	int erase_range(const T& lo, const T& hi) {
+		typename Stats::scope scope(AVL_REMOVE);
+
+		avl_tree* m = cut_range(lo, hi, typename Balance::joinable());
+
+		if (!m)
+			return 0;
+
+		int removed = m->_size;
+		delete_node(m);
+
+		self_check();
+		return removed;
+	}
+
+	/**
+	 * @brief Remove todas as informações num intervalo e retorna elas numa
+	 *        nova árvore, sem realocar os nós
+	 * 
+	 * Tem o mesmo custo de `erase_range`.
+	 * 
+	 * @param lo Menor informação do intervalo, inclusive
+	 * @param hi Maior informação do intervalo, inclusive
+	 * @return avl_tree Árvore com as informações removidas
+	 */
+	avl_tree extract_range(const T& lo, const T& hi) {
+		typename Stats::scope scope(AVL_REMOVE);
+
+		avl_tree removed(node_tag(), *this);
+		avl_tree* m = cut_range(lo, hi, typename Balance::joinable());
+
+		if (m) {
+			swap_nodes(removed, *m);
+			delete_node(m);
+		}
+
+		self_check();
+		removed.self_check();
+		return removed;
+	}
+
+	/**
+	 * @brief Nó desligado de uma árvore, com a sua informação
+	 * 
+	 * O nó pertence ao objeto e é liberado com ele, a menos que seja ligado
+	 * de novo a uma árvore do mesmo tipo com `insert`.
+	 */
+	class node_type {
+		friend class avl_tree;
+
+	private:
+		avl_tree* node;		//! Nó desligado, ou nullptr
+
+		explicit node_type(avl_tree* node) : node(node) {}
+
+	public:
+
+		/**
+		 * @brief Construtor, de um nó vazio
+		 */
+		node_type() : node(nullptr) {}
+
+		/**
+		 * @brief Construtor de movimento
+		 */
+		node_type(node_type && other) : node(other.node) {
+			other.node = nullptr;
+		}
+
+		/**
+		 * @brief Operador de movimento
+		 */
+		node_type & operator = (node_type && other) {
+			std::swap(node, other.node);
+			return *this;
+		}
+
+		node_type(const node_type &) = delete;
+		node_type & operator = (const node_type &) = delete;
+
+		/**
+		 * @brief Destrutor, libera o nó se ele não foi ligado a uma árvore
+		 */
+		~node_type() {
+			if (node)
+				delete_node(node);
+		}
+
+		/**
+		 * @brief Determina se o objeto não tem nenhum nó
+		 */
+		bool empty() const {
+			return node == nullptr;
+		}
+
+		explicit operator bool() const {
+			return node != nullptr;
+		}
+
+		/**
+		 * @brief Obtém a informação do nó, que pode ser alterada antes de
+		 *        ligá-lo de novo
+		 * 
+		 * @return T& A informação do nó
+		 */
+		T& value() const {
+			return *node->info;
+		}
+	};
+
+	/**
+	 * @brief Nós desligados de árvores, que são liberados aos poucos
+	 * 
+	 * `clear(reclaimer&)` passa os nós de uma árvore para o objeto em O(1),
+	 * e cada chamada de `reclaim` libera uma parte limitada deles, então
+	 * quem atende requisições não para enquanto uma árvore inteira é
+	 * liberada. O objeto também pode ser movido para outra thread, que
+	 * libera os nós em segundo plano; os nós compartilhados com cópias das
+	 * árvores ficam com elas, pois as contagens são atômicas. O que sobrar
+	 * é liberado no destrutor.
+	 */
+	class reclaimer {
+		friend class avl_tree;
+
+	private:
+		std::vector<avl_tree*> pending;	//! Raízes das subárvores por liberar
+
+		/**
+		 * @brief Recebe uma subárvore, se ela não pertencer a outra árvore
+		 */
+		void push(avl_tree* node) {
+			if (node && release(node))
+				pending.push_back(node);
+		}
+
+	public:
+
+		reclaimer() {}
+
+		reclaimer(reclaimer && other) : pending(std::move(other.pending)) {}
+
+		reclaimer & operator = (reclaimer && other) {
+			pending.swap(other.pending);
 			return *this;
+		}
+
+		reclaimer(const reclaimer &) = delete;
+		reclaimer & operator = (const reclaimer &) = delete;
+
+		/**
+		 * @brief Destrutor, libera os nós que sobraram
+		 */
+		~reclaimer() {
+			for (avl_tree* node : pending)
+				delete_owned(node);
+		}
+
+		/**
+		 * @brief Determina se não há mais nós a liberar
+		 */
+		bool empty() const {
+			return pending.empty();
+		}
+
+		/**
+		 * @brief Libera até um número de nós
+		 * 
+		 * @param count Número máximo de nós, cada um liberado em O(1)
+		 * @return true se ainda há nós a liberar
+		 * @return false caso contrário
+		 */
+		bool reclaim(std::size_t count) {
+			for (; count > 0 && !pending.empty(); count--) {
+				// Se faltar memória, nenhum galho fica sem dono
+				if (pending.size() == pending.capacity())
+					pending.reserve(2 * pending.size());
+
+				avl_tree* node = pending.back();
+				pending.pop_back();
+
+				avl_tree *l, *r;
+				free_node(node, l, r);
 
-		this->~avl_tree();
+				// O galho menor fica no topo, como em `delete_owned`
+				if (l && r && l->_size + l->_dead > r->_size + r->_dead)
+					std::swap(l, r);
 
-		info = clone_ptr(model.info);
-		left = clone_ptr(model.left);
-		right = clone_ptr(model.right);
-		_height = model._height;
-		_size = model._size;
+				if (r)
+					pending.push_back(r);
 
-		return *this;
-	}
-	
-	/**
-	 * @brief Operador de swap
-	 * 
-	 * @param first Primeiro objeto
-	 * @param other Outro objeto
-	 */
-	friend void swap(avl_tree & first, avl_tree & other) {
-		using std::swap;
+				if (l)
+					pending.push_back(l);
+			}
+
+			return !pending.empty();
+		}
+	};
 
-		swap(first.info, other.info);
-		swap(first.left, other.left);
-		swap(first.right, other.right);
-		swap(first._height, other._height);
-		swap(first._size, other._size);
-	}
-	
 	/**
-	 * @brief Obtém a altura da árvore
+	 * @brief Desliga da árvore o nó de uma informação, sem copiar nem
+	 *        liberar a informação
 	 * 
-	 * @return int a altura da árvore
-	 */
-	int height() const {
-		return _height;
-	}
-	
-	/**
-	 * @brief Obtém a quantidade de elementos da árvore
+	 * O nó só é alocado quando a árvore tem um único elemento, pois a raiz é
+	 * o próprio objeto da árvore.
 	 * 
-	 * @return int a quantidade de elementos da árvore
+	 * @param data Informação a ser desligada
+	 * @return node_type O nó desligado
 	 */
-	int size() const {
-		return _size;
-	}
+	node_type extract(const T& data) {
+		typename Stats::scope scope(AVL_REMOVE);
 
-	/**
-	 * @brief Determina se a árvore é uma folha
-	 * 
-	 * @return true se a árvore for uma folha
-	 * @return false caso contrário
-	 */
-	bool is_leaf() const {
-		return left == nullptr && right == nullptr;
+		avl_tree* node = extract_node(*this, data);
+
+		if (node == this) {
+			node = new_node();
+
+			std::swap(info, node->info);
+			recalculate(false);
+		}
+
+		node->_height = 1;
+		node->update_size();
+
+		self_check();
+		return node_type(node);
 	}
 
 	/**
-	 * @brief Determina se a árvore está vazia
+	 * @brief Liga à árvore um nó desligado, sem alocar nem copiar a
+	 *        informação
 	 * 
-	 * @return true se a árvore não tiver nenhum elemento ou nó filho
-	 * @return false caso contrário
-	 */
-	bool empty() const {
-		return info == nullptr;
-	}
-	
-	/**
-	 * @brief Obtém o menor valor da árvore
+	 * Se a informação já existir na árvore, a exceção é lançada e o nó
+	 * continua no objeto recebido.
 	 * 
-	 * @return T Menor valor contido na árvore
+	 * @param handle Nó desligado de uma árvore do mesmo tipo
 	 */
-	T min() const {
-		if (empty())
-			throw "Empty tree has no minimum value";
+	void insert(node_type && handle) {
+		typename Stats::scope scope(AVL_INSERT);
 
-		if (left)
-			return left->min();
+		if (!handle.node)
+			return;
 
-		return *info;
+		// O valor pode ter sido alterado pelo identificador
+		storage_t::refresh(handle.node->info);
+
+		link(*this, handle.node);
+		handle.node = nullptr;
+
+		self_check();
 	}
 
 	/**
-	 * @brief Obtém o maior valor da árvore
+	 * @brief Desliga o nó do menor valor da árvore, sem copiar nem liberar
+	 *        a informação
 	 * 
-	 * @return T Maior valor contido na árvore
+	 * Para uma fila de prioridade: o nó pode ser ligado de novo com
+	 * `insert`, depois de alterado, sem nenhuma alocação.
+	 * 
+	 * @return node_type O nó do menor valor
 	 */
-	T max() const {
-		if (empty())
-			throw "Empty tree has no maximum value";
+	node_type pop_min() {
+		typename Stats::scope scope(AVL_POPLEFT);
 
-		if (right)
-			return right->max();
+		if (_size == 0)
+			throw "Can't pop from an empty tree";
+
+		// As lápides encontradas na ponta são descartadas
+		for (;;) {
+			avl_tree* node = unlink_end(false);
+
+			if (!node->_tombstone) {
+				self_check();
+				return node_type(node);
+			}
 
-		return *info;
+			delete_node(node);
+		}
 	}
-	
+
 	/**
-	 * @brief Remove o maior valor da árvore e retorna
+	 * @brief Desliga o nó do maior valor da árvore, sem copiar nem liberar
+	 *        a informação
 	 * 
-	 * @return T Maior valor contido na árvore
+	 * @return node_type O nó do maior valor
 	 */
-	T pop() {
-		if (empty())
+	node_type pop_max() {
+		typename Stats::scope scope(AVL_POP);
+
+		if (_size == 0)
 			throw "Can't pop from an empty tree";
 
-		T aux;
+		// As lápides encontradas na ponta são descartadas
+		for (;;) {
+			avl_tree* node = unlink_end(true);
 
-		if (right) {
-			aux = right->pop();
-			delete_if_empty(right);
+			if (!node->_tombstone) {
+				self_check();
+				return node_type(node);
+			}
 
-		} else {
-			aux = *info;
-			info = left ? new T(left->popleft()) : nullptr;
-			delete_if_empty(left);
+			delete_node(node);
 		}
-
-		recalculate();
-
-		return aux;
 	}
 
 	/**
-	 * @brief Remove o menor valor da árvore e retorna
+	 * @brief Move para esta árvore todos os nós de outra, sem alocar nem
+	 *        copiar as informações
 	 * 
-	 * @return T Menor valor contido na árvore
+	 * As informações que já existem nesta árvore ficam na outra, e as
+	 * lápides da outra são descartadas. Só a raiz da outra árvore, que é o
+	 * próprio objeto, é movida para um nó novo.
+	 * 
+	 * @param other Árvore de onde os nós são movidos
 	 */
-	T popleft() {
-		if (empty())
-			throw "Can't pop from an empty tree";
+	void merge(avl_tree & other) {
+		if (this == &other || other.empty())
+			return;
 
-		T aux;
+		// A raiz é o próprio objeto; os nós são todos movidos para o heap
+		avl_tree* t = new_node();
+		swap_nodes(other, *t);
 
-		if (left) {
-			aux = left->popleft();
-			delete_if_empty(left);
+		std::vector<avl_tree*> stack;
+		vine rest(*this);
 
-		} else {
-			aux = *info;
-			info = right ? new T(right->pop()) : nullptr;
-			delete_if_empty(right);
+		// Os nós compartilhados com cópias da árvore são copiados antes de
+		// serem desmontados
+		while (t || !stack.empty()) {
+			for (; t; t = t->left)
+				stack.push_back(own(t));
+
+			t = stack.back();
+			stack.pop_back();
+
+			avl_tree* next = t->right;
+			t->left = t->right = nullptr;
+
+			if (t->_tombstone) {
+				delete_node(t);
+
+			} else {
+				// Uma informação repetida é rejeitada antes de mudar a árvore
+				try {
+					link(*this, t);
+				} catch (const char*) {
+					rest.append(t);
+				}
+			}
+
+			t = next;
 		}
-		
-		recalculate();
 
-		return aux;
+		other.assemble(rest);
+
+		self_check();
+		other.self_check();
 	}
 
 	/**
-	 * @brief Remove todas as informações da árvore
+	 * @brief Obtém o agregado de todas as informações da árvore
+	 * 
+	 * @return aggregate_type A combinação, em ordem, das informações
 	 */
-	void clear() {
-		this->~avl_tree();
-
-		info = nullptr;
-		left = right = nullptr;
-		_height = 0;
-		_size = 0;
+	const aggregate_type& aggregate() const {
+		return this->_aggregate;
 	}
 
 	/**
-	 * @brief Insere uma informação na árvore
+	 * @brief Calcula o agregado das informações num intervalo, em O(log n)
 	 * 
-	 * @param data Dados a serem inseridos na árvore
+	 * @param lo Menor informação do intervalo, inclusive
+	 * @param hi Maior informação do intervalo, inclusive
+	 * @return aggregate_type A combinação, em ordem, das informações entre
+	 *         `lo` e `hi`
 	 */
-	void insert(T data) {
-		Compare is_less;
-		Equal is_equal;
+	aggregate_type aggregate(const T& lo, const T& hi) const {
+		const cmp_t& cmp = *this;
+		const avl_tree* t = empty() ? nullptr : this;
+
+		// Desce até o primeiro nó dentro do intervalo
+		while (t) {
+			if (less_than(cmp, *t->info, lo))
+				t = t->right;
+			else if (less_than(cmp, hi, *t->info))
+				t = t->left;
+			else
+				break;
+		}
 
-		if (info == nullptr) {
-			info = new T(data);
-			_height = 1;
+		if (!t)
+			return Augment::identity();
 
-		} else if (is_equal(data, *info)) {
-			throw "Repeated information";
+		// À esquerda, junta os nós maiores que `lo` e as suas subárvores
+		// direitas, sempre antes do que já foi juntado
+		aggregate_type low = Augment::identity();
 
-		} else if (is_less(data, *info)) {
-			if (left == nullptr)
-				left = new avl_tree();
+		for (const avl_tree* l = t->left; l; ) {
+			if (less_than(cmp, *l->info, lo)) {
+				l = l->right;
 
-			left->insert(data);
+			} else {
+				aggregate_type part = l->own_aggregate();
 
-		} else {
-			if (right == nullptr)
-				right = new avl_tree();
+				if (l->right)
+					part = Augment::combine(part, l->right->_aggregate);
 
-			right->insert(data);
+				low = Augment::combine(part, low);
+				l = l->left;
+			}
 		}
-		
-		_size++;
 
-		recalculate();
-	}
-	
-	/**
-	 * @brief Atualiza uma informação na árvore
-	 * 
-	 * @param data Dados a serem atualizados na árvore
-	 */
-	void update(const T& data) {
-		Compare is_less;
-		Equal is_equal;
+		// À direita, o contrário
+		aggregate_type high = Augment::identity();
 
-		if (info == nullptr) {
-			insert(data);
+		for (const avl_tree* r = t->right; r; ) {
+			if (less_than(cmp, hi, *r->info)) {
+				r = r->left;
 
-		} else if (is_equal(data, *info)) {
-			*info = data;
+			} else {
+				aggregate_type part = r->own_aggregate();
 
-		} else if (is_less(data, *info)) {
-			if (left == nullptr)
-				insert(data);
-			else
-				left->update(data);
+				if (r->left)
+					part = Augment::combine(r->left->_aggregate, part);
 
-		} else {
-			if (right == nullptr)
-				insert(data);
-			else
-				right->update(data);
+				high = Augment::combine(high, part);
+				r = r->right;
+			}
 		}
 
-		recalculate();
+		return Augment::combine(Augment::combine(low, t->own_aggregate()), high);
 	}
 
 	/**
-	 * @brief Remove uma informação da árvore
-	 * 
-	 * @param data Informação a ser removida
+	 * @brief Percorre em ordem as informações cujo valor no agregado
+	 *        satisfaz um predicado, sem recursão
+	 *
+	 * O predicado tem de ser falso no agregado de uma subárvore sempre que
+	 * for falso para todas as informações dela, como "o máximo é pelo menos
+	 * x"; assim, as subárvores rejeitadas pelo agregado são puladas sem
+	 * serem visitadas. O percurso termina na primeira informação que
+	 * satisfaz `past`, pois todas as maiores também satisfariam. São
+	 * visitados O((k + 1) log n) nós, em que k é o número de informações
+	 * passadas a `fn`.
+	 *
+	 * @param accept Predicado sobre o agregado de uma subárvore ou de uma
+	 *        informação
+	 * @param past Determina se uma informação está além do fim da busca
+	 * @param fn Função chamada com cada informação aceita
 	 */
-	void remove(const T & data) {
-		Compare is_less;
-		Equal is_equal;
-
-		if (empty())
-			throw "Can't remove from empty tree";
-
-		if (is_equal(*info, data)) {
-			if (left) {
-				*info = left->pop();
-				delete_if_empty(left);
-
-			} else if (right) {
-				*info = right->popleft();
-				delete_if_empty(right);
-
-			} else {
-				delete info;
-				info = nullptr;
-				_height = 0;
-				_size = 0;
-
+	template <class Accept, class Past, class Function> void for_each_where(
+		Accept accept,
+		Past past,
+		Function fn
+	) const {
+		std::vector<const avl_tree*> nodes;
+		const avl_tree* t = empty() ? nullptr : this;
+
+		for (;;) {
+			for (; t && accept(t->_aggregate); t = t->left)
+				nodes.push_back(t);
+
+			if (nodes.empty())
 				return;
-			}
-
-		} else if (left && is_less(data, *info)) {
-			left->remove(data);
-			delete_if_empty(left);
 
-		} else if (right) {
-			right->remove(data);
-			delete_if_empty(right);
+			t = nodes.back();
+			nodes.pop_back();
 
-		} else
-			throw "Information not found";
+			if (past(*t->info))
+				return;
 
-		_size--;
+			if (!t->_tombstone && accept(t->own_aggregate()))
+				fn(*t->info);
 
-		recalculate();
+			t = t->right;
+		}
 	}
-	
+
 	/**
 	 * @brief Busca uma informação existe na árvore
 	 * 
 	 * @param data Dados a serem procurados
 	 */
 	bool find(T& data) const {
-		Compare is_less;
-		Equal is_equal;
+		typename Stats::scope scope(AVL_FIND);
+		const avl_tree* t = locate(data);
 
-		if (empty())
+		if (!t || t->_tombstone)
 			return false;
 
-		if (is_equal(*info, data)) {
-			data = *info;
-			return true;
-
-		} else if (left && is_less(data, *info))
-			return left->find(data);
-
-		else if (right)
-			return right->find(data);
-
-		else
-			return false;
+		data = *t->info;
+		return true;
 	}
 
 	/**
@@ -489,6 +3426,97 @@ public:
 	bool includes(T data) const {
 		return find(data);
 	}
+
+	/**
+	 * @brief Confere os invariantes da árvore, em O(n) e sem recursão
+	 * 
+	 * Confere a ordem das informações, inclusive as das lápides, e em cada
+	 * nó a altura e o balanceamento, pela política de balanceamento, o
+	 * número de elementos e de lápides, o prefixo guardado da chave e a
+	 * contagem de compartilhamento. Os agregados não são conferidos.
+	 * 
+	 * Com `AVL_TREE_VALIDATE` definida antes de incluir o cabeçalho, as
+	 * operações que alteram a árvore chamam esta função ao terminar.
+	 * 
+	 * @throw const char* Descrição do primeiro invariante quebrado
+	 */
+	void validate() const {
+		if (empty()) {
+			if (left || right || _size != 0 || _dead != 0 || _height != 0)
+				throw "Invalid tree: empty root with branches or counts";
+
+			return;
+		}
+
+		if (_shares.load(std::memory_order_relaxed) != 0)
+			throw "Invalid tree: shared root";
+
+		const cmp_t& cmp = *this;
+		const T* last = nullptr;
+		std::vector<const avl_tree*> nodes;
+		const avl_tree* t = this;
+
+		while (t || !nodes.empty()) {
+			for (; t; t = t->left)
+				nodes.push_back(t);
+
+			t = nodes.back();
+			nodes.pop_back();
+
+			if (!t->info)
+				throw "Invalid tree: empty node";
+
+			// Sem `less_than`, para não contar as comparações na instrumentação
+			if (last && !cmp.key_comp()(*last, *t->info))
+				throw "Invalid tree: information out of order";
+
+			int size = t->_tombstone ? 0 : 1,
+				dead = t->_tombstone ? 1 : 0;
+
+			if (t->left) {
+				size += t->left->_size;
+				dead += t->left->_dead;
+			}
+
+			if (t->right) {
+				size += t->right->_size;
+				dead += t->right->_dead;
+			}
+
+			if (t->_size != size || t->_dead != dead)
+				throw "Invalid tree: wrong element or tombstone count";
+
+			if (!Balance::valid(*t))
+				throw "Invalid tree: wrong height or unbalanced node";
+
+			if (storage_t::order(storage_t::probe(*t->info), t->info) != 0)
+				throw "Invalid tree: stale key prefix";
+
+			if (t->_shares.load(std::memory_order_relaxed) < 0)
+				throw "Invalid tree: negative share count";
+
+			last = &*t->info;
+			t = t->right;
+		}
+	}
+
+	/**
+	 * @brief Obtém um retrato dos contadores da política de instrumentação
+	 * 
+	 * Os contadores pertencem à política, e não a uma árvore específica.
+	 * 
+	 * @return Stats::snapshot Os contadores
+	 */
+	static typename Stats::snapshot stats() {
+		return Stats::stats();
+	}
+
+	/**
+	 * @brief Zera os contadores da política de instrumentação
+	 */
+	static void reset_stats() {
+		Stats::reset();
+	}
 	
 	/**
 	 * @brief Escreve uma árvore para uma stream de saída em ordem
@@ -501,25 +3529,184 @@ public:
 		std::ostream & out,
 		const avl_tree& tree
 	) {
-		out << "( ";
+		// Pilha de ações pendentes: escrever uma subárvore ('s'), a
+		// informação de um nó ('i') ou um caractere literal
+		std::vector<std::pair<const avl_tree*, char> > stack;
+		text_writer w(out);
+
+		stack.push_back(std::make_pair(&tree, 's'));
+
+		while (!stack.empty()) {
+			const avl_tree* t = stack.back().first;
+			char action = stack.back().second;
+			stack.pop_back();
+
+			if (action == 'i') {
+				w.put(*t->info);
+
+			} else if (action != 's') {
+				w.put(action);
+
+			} else {
+				w.put('(');
+				w.put(' ');
+
+				// Empilhadas em ordem reversa à de escrita
+				stack.push_back(std::make_pair(t, ')'));
+
+				// Lápides e subárvores só com lápides não são escritas
+				if (t->right && t->right->_size > 0) {
+					stack.push_back(std::make_pair(t, ' '));
+					stack.push_back(std::make_pair(t->right, 's'));
+				}
+
+				if (t->info && !t->_tombstone) {
+					stack.push_back(std::make_pair(t, ' '));
+					stack.push_back(std::make_pair(t, 'i'));
+				}
+
+				if (t->left && t->left->_size > 0) {
+					stack.push_back(std::make_pair(t, ' '));
+					stack.push_back(std::make_pair(t->left, 's'));
+				}
+			}
+		}
+
+		return out;
+	}
+
+	/**
+	 * @brief Lê uma árvore escrita por `operator <<` de uma stream de entrada
+	 *
+	 * @param in Stream de entrada
+	 * @param tree Árvore que recebe os elementos lidos
+	 * @return std::istream& A stream recebida por parâmetro
+	 */
+	friend std::istream & operator >>(
+		std::istream & in,
+		avl_tree& tree
+	) {
+		tree.load_text(in);
+		return in;
+	}
+
+	/**
+	 * @brief Ordens de percurso da árvore
+	 */
+	enum traversal {
+		in_order,		//! Em ordem
+		pre_order,		//! Pré-ordem
+		post_order,		//! Pós-ordem
+		level_order		//! Por nível
+	};
+
+	/**
+	 * @brief Escreve os elementos da árvore separados por espaços, sem
+	 *        recursão e com buffer próprio
+	 * 
+	 * No percurso por nível, cada nível é escrito numa linha.
+	 * 
+	 * @param out Stream de saída
+	 * @param order Ordem de percurso
+	 */
+	void dump(std::ostream & out, traversal order = in_order) const {
+		text_writer w(out);
+		std::vector<const avl_tree*> nodes;
+		const avl_tree* t = empty() ? nullptr : this;
+
+		switch (order) {
+		case in_order:
+			while (t || !nodes.empty()) {
+				for (; t; t = t->left)
+					nodes.push_back(t);
+
+				t = nodes.back();
+				nodes.pop_back();
+
+				if (!t->_tombstone) {
+					w.put(*t->info);
+					w.put(' ');
+				}
+
+				t = t->right;
+			}
+			break;
+
+		case pre_order:
+			if (t)
+				nodes.push_back(t);
+
+			while (!nodes.empty()) {
+				t = nodes.back();
+				nodes.pop_back();
+
+				if (!t->_tombstone) {
+					w.put(*t->info);
+					w.put(' ');
+				}
+
+				if (t->right)
+					nodes.push_back(t->right);
+
+				if (t->left)
+					nodes.push_back(t->left);
+			}
+			break;
+
+		case post_order: {
+			const avl_tree* last = nullptr;
+
+			while (t || !nodes.empty()) {
+				if (t) {
+					nodes.push_back(t);
+					t = t->left;
+					continue;
+				}
+
+				const avl_tree* top = nodes.back();
+
+				// Desce à direita se ela ainda não foi visitada
+				if (top->right && top->right != last) {
+					t = top->right;
+					continue;
+				}
 
-		if (tree.left)
-			out << *tree.left << " ";
+				if (!top->_tombstone) {
+					w.put(*top->info);
+					w.put(' ');
+				}
 
-		if (tree.info)
-			out << *tree.info << " ";
+				last = top;
+				nodes.pop_back();
+			}
+			break;
+		}
 
-		if (tree.right)
-			out << *tree.right << " ";
+		case level_order: {
+			int level = 0;
 
-		out << ")";
+			for_each_level([&](const T& data, int lv) {
+				if (lv != level) {
+					w.put('\n');
+					level = lv;
+				}
 
-		return out;
+				w.put(data);
+				w.put(' ');
+			});
+			break;
+		}
+		}
+
+		w.put('\n');
 	}
 
 	/**
 	 * @brief Obtém a árvore à esquerda
 	 * 
+	 * O nó pode ser compartilhado com cópias da árvore, e não deve ser
+	 * alterado.
+	 * 
 	 * @return avl_tree* Nó à esquerda
 	 */
 	avl_tree* get_left() {
@@ -529,6 +3716,9 @@ public:
 	/**
 	 * @brief Obtém a árvore à direita
 	 * 
+	 * O nó pode ser compartilhado com cópias da árvore, e não deve ser
+	 * alterado.
+	 * 
 	 * @return avl_tree* Nó à direita
 	 */
 	avl_tree* get_right() {
@@ -544,63 +3734,184 @@ public:
 		return *this->info;
 	}
 
+private:
+
+	/**
+	 * @brief Fila circular de nós usada no percurso por nível
+	 * 
+	 * A capacidade inicial é a largura máxima de um nível, calculada a partir
+	 * da altura e do tamanho da árvore, então a fila só realoca se a árvore
+	 * tiver algum nível mais largo que o esperado.
+	 */
+	class level_queue {
+	public:
+		typedef std::pair<int, const avl_tree*> node;	//! Nível e nó
+
+	private:
+		std::vector<node> ring;		//! Buffer circular, potência de 2
+		size_t head;				//! Posição do primeiro elemento
+		size_t count;				//! Número de elementos na fila
+
+		/**
+		 * @brief Dobra a capacidade da fila
+		 */
+		void grow() {
+			std::vector<node> bigger(ring.size() * 2);
+
+			for (size_t i = 0; i < count; i++)
+				bigger[i] = ring[(head + i) & (ring.size() - 1)];
+
+			ring.swap(bigger);
+			head = 0;
+		}
+
+	public:
+
+		/**
+		 * @brief Construtor
+		 * 
+		 * @param t Árvore a ser percorrida
+		 */
+		explicit level_queue(const avl_tree* t) : head(0), count(0) {
+			size_t width = 1;
+
+			if (t) {
+				size_t limit = t->_size;
+
+				for (int h = t->_height; h > 1 && width < limit; h--)
+					width <<= 1;
+			}
+
+			ring.resize(width);
+		}
+
+		/**
+		 * @brief Determina se a fila está vazia
+		 */
+		bool empty() const {
+			return count == 0;
+		}
+
+		/**
+		 * @brief Adiciona um nó ao fim da fila
+		 */
+		void push(int level, const avl_tree* t) {
+			if (count == ring.size())
+				grow();
+
+			ring[(head + count) & (ring.size() - 1)] = node(level, t);
+			count++;
+		}
+
+		/**
+		 * @brief Remove e retorna o nó do começo da fila
+		 */
+		node pop() {
+			node n = ring[head];
+
+			head = (head + 1) & (ring.size() - 1);
+			count--;
+
+			return n;
+		}
+	};
+
+public:
+
+	/**
+	 * @brief Percorre a árvore por nível, sem copiar iteradores
+	 * 
+	 * @param fn Função chamada com cada informação e o seu nível
+	 */
+	template <class Function> void for_each_level(Function fn) const {
+		if (_size == 0)
+			return;
+
+		level_queue q(this);
+		q.push(0, this);
+
+		while (!q.empty()) {
+			typename level_queue::node current = q.pop();
+			const avl_tree* t = current.second;
+
+			if (!t->_tombstone)
+				fn(*t->info, current.first);
+
+			// Subárvores só com lápides não são visitadas
+			if (t->left && t->left->_size > 0)
+				q.push(current.first + 1, t->left);
+
+			if (t->right && t->right->_size > 0)
+				q.push(current.first + 1, t->right);
+		}
+	}
+
 	/**
 	 * @brief Classe de iterador por nível da árvore AVL
+	 * 
+	 * É um iterador de entrada: as cópias compartilham a mesma fila, então
+	 * só a posição atual é copiada e uma cópia antiga continua apontando
+	 * para o elemento em que estava.
 	 */
 	class level_iterator : public std::iterator<std::input_iterator_tag, T> {
 		friend class avl_tree;
 
 	private:
-		typedef std::pair<int, const avl_tree*> node;	//! Tipo usado para um nó na árvore
+		typedef typename level_queue::node node;	//! Tipo usado para um nó na árvore
 
-		std::queue<node> q;								//! Fila do iterador
-		int _level;										//! Nível atual do iterador na árvore
+		std::shared_ptr<level_queue> q;				//! Fila compartilhada do percurso
+		node current;								//! Nó atual do iterador
 
 		/**
 		 * @brief Construtor
 		 * 
 		 * @param t Ponteiro para a árvore AVL de início
 		 */
-		level_iterator(const avl_tree* t) {
-			if (t)
-				q.push(node(0, t));
-
-			_level = 0;
+		level_iterator(const avl_tree* t) : current(0, t) {
+			if (t) {
+				q = std::make_shared<level_queue>(t);
+				settle();
+			}
 		}
 
-	public:
+		/**
+		 * @brief Avança para o próximo nó na fila
+		 */
+		void step() {
+			int lv = current.first;
+			const avl_tree* t = current.second;
+
+			// Subárvores só com lápides não são visitadas
+			if (t->left && t->left->_size > 0)
+				q->push(lv + 1, t->left);
+
+			if (t->right && t->right->_size > 0)
+				q->push(lv + 1, t->right);
+
+			current = q->empty() ? node(0, nullptr) : q->pop();
+		}
 
 		/**
-		 * @brief Construtor de cópia
-		 * 
-		 * @param other Objeto modelo
+		 * @brief Avança até um nó que não seja uma lápide
 		 */
-		level_iterator(const level_iterator & other) {
-			q = other.q;
-			_level = other._level;
+		void settle() {
+			while (current.second && current.second->_tombstone)
+				step();
 		}
 
+	public:
+
 		/**
 		 * @brief Operador de incremento prefixo
 		 * 
 		 * @return level_iterator& Este iterador, uma posição à frente
 		 */
 		level_iterator& operator++() {
-			if (q.empty())
+			if (!current.second)
 				throw "Iterator ran out of bounds";
 
-			node current = q.front();
-
-			int lv = current.first;
-			const avl_tree* t = current.second;
-
-			if (t->left)
-				q.push(node(lv + 1, t->left));
-
-			if (t->right)
-				q.push(node(lv + 1, t->right));
-
-			q.pop();
+			step();
+			settle();
 
 			return *this;
 		}
@@ -615,7 +3926,7 @@ public:
 			using std::swap;
 
 			swap(a.q, b.q);
-			swap(a.level, b.level);
+			swap(a.current, b.current);
 		}
 
 		/**
@@ -637,13 +3948,7 @@ public:
 		 * @return false se não
 		 */
 		bool operator==(const level_iterator & other) const {
-			if (q.empty())
-				return other.q.empty();
-
-			else if (other.q.empty())
-				return false;
-
-			return q.front() == other.q.front();
+			return current.second == other.current.second;
 		}
 
 		/**
@@ -662,8 +3967,8 @@ public:
 		 * 
 		 * @return int O nível atual na árvore
 		 */
-		int level() {
-			return q.front().first;
+		int level() const {
+			return current.first;
 		}
 
 		/**
@@ -672,7 +3977,7 @@ public:
 		 * @return T& A informação atual
 		 */
 		const T& operator*() const {
-			return *q.front().second->info;
+			return *current.second->info;
 		}
 
 		/**
@@ -681,7 +3986,7 @@ public:
 		 * @return T& Ponteiro da informação atual
 		 */
 		const T* operator->() const {
-			return q.front().second->info;
+			return &*current.second->info;
 		}
 	};
 
@@ -693,7 +3998,7 @@ public:
 
 	private:
 
-		std::stack<const avl_tree*> stack;	//! Pilha de nós percorridos
+		std::vector<const avl_tree*> path;	//! Caminho da raiz até o nó atual
 
 		/**
 		 * @brief Construtor
@@ -701,12 +4006,55 @@ public:
 		 * @param tree Árvore a ser percorrida
 		 */
 		inorder_iterator(const avl_tree* tree) {
-			if (tree) {
-				stack.push(tree);
+			descend(tree);
+			settle();
+		}
+
+		/**
+		 * @brief Construtor a partir de um caminho já conhecido
+		 * 
+		 * @param path Caminho da raiz até o nó atual
+		 */
+		inorder_iterator(std::vector<const avl_tree*>&& path)
+			: path(std::move(path)) {}
 
-				while (stack.top()->left)
-					stack.push(stack.top()->left);
+		/**
+		 * @brief Desce por uma subárvore até o seu nó mais à esquerda,
+		 *        ignorando subárvores só com lápides
+		 * 
+		 * @param t Raiz da subárvore
+		 */
+		void descend(const avl_tree* t) {
+			for (; t && t->_size > 0; t = t->left)
+				path.push_back(t);
+		}
+
+		/**
+		 * @brief Avança para o próximo nó em ordem
+		 */
+		void step() {
+			const avl_tree* current = path.back();
+
+			if (current->right && current->right->_size > 0) {
+				descend(current->right);
+				return;
 			}
+
+			// Sobe enquanto estiver voltando de um galho à direita
+			const avl_tree* child;
+
+			do {
+				child = path.back();
+				path.pop_back();
+			} while (!path.empty() && path.back()->right == child);
+		}
+
+		/**
+		 * @brief Avança até um nó que não seja uma lápide
+		 */
+		void settle() {
+			while (!path.empty() && path.back()->_tombstone)
+				step();
 		}
 
 	public:
@@ -717,18 +4065,11 @@ public:
 		 * @return level_iterator& Este iterador, uma posição à frente
 		 */
 		inorder_iterator& operator++() {
-			if (stack.empty())
+			if (path.empty())
 				throw "Iterator ran out of bounds";
 
-			const avl_tree* current = stack.top();
-			stack.pop();
-
-			if (current->right) {
-				stack.push(current->right);
-
-				while (stack.top()->left)
-					stack.push(stack.top()->left);
-			}
+			step();
+			settle();
 
 			return *this;
 		}
@@ -742,7 +4083,7 @@ public:
 		friend void swap(inorder_iterator & a, inorder_iterator & b) {
 			using std::swap;
 
-			swap(a.stack, b.stack);
+			swap(a.path, b.path);
 		}
 
 		/**
@@ -764,13 +4105,13 @@ public:
 		 * @return false se não
 		 */
 		bool operator==(const inorder_iterator & other) const {
-			if (stack.empty())
-				return other.stack.empty();
+			if (path.empty())
+				return other.path.empty();
 
-			else if (other.stack.empty())
+			else if (other.path.empty())
 				return false;
 
-			return stack.top() == other.stack.top();
+			return path.back() == other.path.back();
 		}
 
 		/**
@@ -790,7 +4131,7 @@ public:
 		 * @return T& A informação atual
 		 */
 		const T& operator*() const {
-			return *stack.top()->info;
+			return *path.back()->info;
 		}
 
 		/**
@@ -799,7 +4140,7 @@ public:
 		 * @return T& Ponteiro da informação atual
 		 */
 		const T* operator->() const {
-			return stack.top()->info;
+			return &*path.back()->info;
 		}
 	};
 
@@ -839,54 +4180,408 @@ public:
 		return inorder_iterator(nullptr);
 	}
 
+private:
+
 	/**
-	 * @brief Salva uma árvore num arquivo .gv na linguagem dot
+	 * @brief Copia o caminho de um iterador desta árvore, não vazia
 	 * 
-	 * @param file Arquivo de saída
+	 * @param hint Iterador desta árvore; o fim equivale ao maior nó
+	 * @param path Recebe o caminho da raiz até o nó do iterador
 	 */
-	void gv_save(std::ofstream& file) {
-		file << "strict graph {" << std::endl;
-        file << "node [shape=rect]" << std::endl;
-		int i = 0;
-		gv_save(file, i);
-		file << "}";
+	void hint_path(const inorder_iterator& hint, std::vector<const avl_tree*>& path) const {
+		path.reserve(_height + 2);
+
+		if (hint.path.empty()) {
+			for (const avl_tree* t = this; t; t = t->right)
+				path.push_back(t);
+
+		} else {
+			if (hint.path.front() != this)
+				throw "Iterator does not belong to this tree";
+
+			path.assign(hint.path.begin(), hint.path.end());
+		}
 	}
 
 	/**
-	 * @brief Salva uma árvore num arquivo .gv na linguagem dot
+	 * @brief Sobe pelo caminho de um iterador até o primeiro ancestral do
+	 *        outro lado que limita uma informação
+	 * 
+	 * Os ancestrais do mesmo lado não precisam ser comparados, então a
+	 * subida faz O(log d) comparações, em que d é a distância em ordem
+	 * entre o nó do iterador e a informação.
 	 * 
-	 * @param file Arquivo de saída
-	 * @param tree Árvore a ser salva
-	 * @param i ID do nó no arquivo (gambiarra)
+	 * @param cmp Comparadores da árvore
+	 * @param path Caminho da raiz até o nó do iterador
+	 * @param data Informação procurada
+	 * @param top Recebe a posição, no caminho, do nó de onde a busca desce
+	 * @param right Recebe se a informação fica à direita desse nó
+	 * @return true se esse nó tem a própria informação
+	 * @return false caso contrário
 	 */
-	void gv_save(std::ofstream& file, int& i, std::string node_prefix = "node") {
-		if (this->empty())
-			return;
+	static bool climb(
+		const cmp_t& cmp,
+		const std::vector<const avl_tree*>& path,
+		const T& data,
+		size_t& top,
+		bool& right
+	) {
+		top = path.size() - 1;
 
-		int current = i;
-		file << "\"" << node_prefix << current << "\" [label=\"" << *info << "\"]" << std::endl;
-		
-		if (this->left) {
-			i++;
+		Stats::visited();
+
+		if (equals(cmp, data, *path[top]->info))
+			return true;
 
-			int left = i;
-			this->left->gv_save(file, i, node_prefix);
+		right = less_than(cmp, *path[top]->info, data);
 
-			file    << "\"" << node_prefix << current << "\""
-					<< " -- "
-					<< "\"" << node_prefix << left << "\"" << std::endl;
+		for (size_t i = path.size() - 1; i > 0; i--) {
+			const avl_tree* parent = path[i - 1];
+
+			if ((parent->left == path[i]) != right)
+				continue;
+
+			Stats::visited();
+
+			if (equals(cmp, data, *parent->info)) {
+				top = i - 1;
+				return true;
+			}
+
+			if (right ? less_than(cmp, data, *parent->info) : less_than(cmp, *parent->info, data))
+				break;
+
+			top = i - 1;
+		}
+
+		return false;
+	}
+
+public:
+
+	/**
+	 * @brief Busca uma informação a partir da posição de um iterador, sem
+	 *        descer desde a raiz
+	 * 
+	 * Sobe e desce como `insert_hint`, com O(log d) comparações, em que d é
+	 * a distância em ordem entre o iterador e a informação. Buscar em ordem
+	 * crescente com o iterador da busca anterior faz O(1) comparações por
+	 * busca, em média.
+	 * 
+	 * @param hint Iterador desta árvore, válido, perto da informação
+	 * @param data Dados a serem procurados
+	 * @return inorder_iterator Iterador para a informação, ou
+	 *         `end_in_order()` se ela não existir
+	 */
+	inorder_iterator find_hint(const inorder_iterator& hint, const T& data) const {
+		typename Stats::scope scope(AVL_FIND);
+
+		if (empty())
+			return end_in_order();
+
+		std::vector<const avl_tree*> path;
+		hint_path(hint, path);
+
+		const cmp_t& cmp = *this;
+		size_t top;
+		bool right = false;
+		bool found = climb(cmp, path, data, top, right);
+
+		path.resize(top + 1);
+
+		for (const avl_tree* t = path.back(); !found; ) {
+			t = right ? t->right : t->left;
+
+			if (!t)
+				return end_in_order();
+
+			path.push_back(t);
+			Stats::visited();
+
+			found = equals(cmp, data, *t->info);
+
+			if (!found)
+				right = less_than(cmp, *t->info, data);
+		}
+
+		if (path.back()->_tombstone)
+			return end_in_order();
+
+		return inorder_iterator(std::move(path));
+	}
+
+	/**
+	 * @brief Insere uma informação a partir da posição de um iterador, sem
+	 *        descer desde a raiz
+	 * 
+	 * A busca sobe pelo caminho do iterador só até o ancestral que limita a
+	 * informação e desce a partir dali, com O(log d) comparações, em que d
+	 * é a distância em ordem entre o iterador e a informação. Inserir em
+	 * ordem crescente com `end_in_order()`, ou com o iterador retornado pela
+	 * inserção anterior, faz O(1) comparações por inserção. O reajuste das
+	 * alturas e tamanhos ainda percorre o caminho até a raiz.
+	 * 
+	 * @param hint Iterador desta árvore, válido, perto da informação
+	 * @param data Dados a serem inseridos na árvore
+	 * @return inorder_iterator Iterador para a informação inserida
+	 */
+	inorder_iterator insert_hint(const inorder_iterator& hint, const T& data) {
+		typename Stats::scope scope(AVL_INSERT);
+
+		if (empty()) {
+			insert(data);
+			return begin_in_order();
+		}
+
+		// O caminho é guardado como no iterador, e os nós são alterados
+		// pela própria árvore, que tem acesso de escrita
+		std::vector<const avl_tree*> path;
+		hint_path(hint, path);
+
+		auto at = [&](size_t i) { return const_cast<avl_tree*>(path[i]); };
+
+		const cmp_t& cmp = *this;
+		size_t top;
+		bool right = false, created = false;
+		bool found = climb(cmp, path, data, top, right);
+
+		path.resize(top + 1);
+		own_path(path);
+
+		avl_tree* t = at(top);
+
+		// Desce a partir do ancestral, como numa inserção comum
+		while (!found) {
+			avl_tree* & child = right ? t->right : t->left;
+
+			if (!child) {
+				child = new_node();
+				child->info = new_info(data);
+				child->_height = 1;
+
+				path.push_back(child);
+				created = true;
+				break;
+			}
+
+			t = own(child);
+			path.push_back(t);
+
+			Stats::visited();
+
+			found = equals(cmp, data, *t->info);
+
+			if (!found)
+				right = less_than(cmp, *t->info, data);
+		}
+
+		t = at(path.size() - 1);
+
+		if (!created) {
+			if (!t->_tombstone)
+				throw "Repeated information";
+
+			// Reaproveita a lápide
+			*t->info = data;
+			t->_tombstone = false;
+		}
+
+		// Reajusta de baixo para cima, lembrando a rotação mais alta
+		const info_ptr inserted = t->info;
+		size_t rotated = path.size();
+
+		for (size_t i = path.size(); i-- > 0; ) {
+			const info_ptr before = path[i]->info;
+			at(i)->recalculate(true);
+
+			if (path[i]->info != before)
+				rotated = i;
+		}
+
+		// Abaixo da rotação mais alta, o caminho até a informação mudou
+		if (rotated < path.size()) {
+			path.resize(rotated + 1);
+
+			for (t = at(rotated); t->info != inserted; path.push_back(t))
+				t = less_than(cmp, *inserted, *t->info) ? t->left : t->right;
 		}
 
-		if (this->right) {
-			i++;
+		self_check();
+		return inorder_iterator(std::move(path));
+	}
+
+	/**
+	 * @brief Opções de exportação para o Graphviz
+	 */
+	struct gv_options {
+		int max_depth;		//! Profundidade máxima exportada (-1 para ilimitada)
+		bool show_height;	//! Anota a altura de cada nó
+		bool show_size;		//! Anota o tamanho de cada subárvore
+		bool show_balance;	//! Anota o fator de balanceamento de cada nó
+
+		gv_options()
+			: max_depth(-1),
+			  show_height(false),
+			  show_size(false),
+			  show_balance(false) {}
+	};
+
+	/**
+	 * @brief Salva uma árvore na linguagem dot do Graphviz
+	 * 
+	 * @param out Stream de saída
+	 * @param opts Opções de exportação
+	 */
+	void gv_save(std::ostream& out, const gv_options& opts = gv_options()) const {
+		gv_write(out, empty() ? nullptr : this, opts);
+	}
+
+	/**
+	 * @brief Salva a subárvore de uma informação na linguagem dot do Graphviz
+	 * 
+	 * @param out Stream de saída
+	 * @param focus Informação na raiz da subárvore exportada
+	 * @param opts Opções de exportação
+	 */
+	void gv_save(
+		std::ostream& out,
+		const T& focus,
+		const gv_options& opts = gv_options()
+	) const {
+		const avl_tree* node = locate(focus);
+
+		if (!node)
+			throw "Information not found";
+
+		gv_write(out, node, opts);
+	}
+
+private:
+
+	/**
+	 * @brief Confere os invariantes ao fim de uma operação, só quando
+	 *        `AVL_TREE_VALIDATE` estiver definida
+	 */
+	void self_check() const {
+#ifdef AVL_TREE_VALIDATE
+		validate();
+#endif
+	}
+
+	/**
+	 * @brief Garante que os nós de um caminho a partir da raiz só pertencem
+	 *        a esta árvore, trocando no caminho os que forem copiados
+	 * 
+	 * @param path Caminho da raiz até um nó, como no iterador em ordem
+	 */
+	static void own_path(std::vector<const avl_tree*>& path) {
+		for (size_t i = 1; i < path.size(); i++) {
+			avl_tree* parent = const_cast<avl_tree*>(path[i - 1]);
+			path[i] = own(parent->left == path[i] ? parent->left : parent->right);
+		}
+	}
+
+	/**
+	 * @brief Busca o nó que contém uma informação, sem recursão
+	 * 
+	 * @param data Informação procurada
+	 * @return const avl_tree* O nó, ou nullptr se não existir
+	 */
+	const avl_tree* locate(const T& data) const {
+		const cmp_t& cmp = *this;
+		const probe_t probe = storage_t::probe(data);
+		const avl_tree* t = empty() ? nullptr : this;
+
+		for (int order; t; t = order < 0 ? t->left : t->right) {
+			Stats::visited();
+
+			if ((order = compare_to(cmp, data, probe, t->info)) == 0)
+				break;
+		}
+
+		return t;
+	}
+
+	/**
+	 * @brief Escreve uma subárvore na linguagem dot, sem recursão e sem
+	 *        forçar a descarga da stream a cada linha
+	 * 
+	 * @param out Stream de saída
+	 * @param root Raiz da subárvore, ou nullptr
+	 * @param opts Opções de exportação
+	 */
+	static void gv_write(
+		std::ostream& out,
+		const avl_tree* root,
+		const gv_options& opts
+	) {
+		struct entry {
+			const avl_tree* node;
+			long id;
+			int depth;
+		};
+
+		out << "strict graph {\n";
+		out << "node [shape=rect]\n";
+
+		std::vector<entry> stack;
+		long next_id = 0;
 
-			int right = i;
-			this->right->gv_save(file, i, node_prefix);
+		if (root) {
+			entry e = { root, next_id++, 0 };
+			stack.push_back(e);
+		}
+
+		while (!stack.empty()) {
+			entry e = stack.back();
+			stack.pop_back();
+
+			const avl_tree* t = e.node;
+
+			out << "\"n" << e.id << "\" [label=\"" << *t->info;
+
+			if (opts.show_height)
+				out << "\\nh=" << t->_height;
+
+			if (opts.show_size)
+				out << "\\ns=" << t->_size;
+
+			if (opts.show_balance)
+				out << "\\nb=" << t->balance_factor();
+
+			// Lápides são desenhadas tracejadas
+			out << (t->_tombstone ? "\", style=dashed]\n" : "\"]\n");
 
-			file    << "\"" << node_prefix << current << "\""
-					<< " -- " 
-					<< "\"" << node_prefix << right << "\"" << std::endl;
+			const avl_tree* children[2] = { t->left, t->right };
+			long ids[2];
+
+			for (int i = 0; i < 2; i++) {
+				if (!children[i])
+					continue;
+
+				ids[i] = next_id++;
+				out << "\"n" << e.id << "\" -- \"n" << ids[i] << "\"\n";
+
+				// Subárvores além do limite viram um nó com a quantidade
+				// de elementos omitidos
+				if (opts.max_depth >= 0 && e.depth >= opts.max_depth)
+					out << "\"n" << ids[i] << "\" [label=\"+" << children[i]->_size
+						<< "\", shape=plaintext]\n";
+			}
+
+			if (opts.max_depth >= 0 && e.depth >= opts.max_depth)
+				continue;
+
+			// A subárvore esquerda é empilhada por último para sair primeiro
+			for (int i = 1; i >= 0; i--) {
+				if (children[i]) {
+					entry c = { children[i], ids[i], e.depth + 1 };
+					stack.push_back(c);
+				}
+			}
 		}
+
+		out << "}\n";
 	}
 };
 
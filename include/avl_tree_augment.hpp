@@ -0,0 +1,153 @@
+/**
+ * @brief Cabeçalho para os aumentos prontos da árvore AVL
+ *
+ * @file avl_tree_augment.hpp
+ */
+
+#ifndef AVL_TREE_AUGMENT_HPP
+#define AVL_TREE_AUGMENT_HPP
+
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "avl_tree.hpp"
+
+/**
+ * @brief Projeção identidade: agrega a própria informação
+ */
+struct avl_identity {
+	template <class U> const U& operator()(const U& data) const {
+		return data;
+	}
+};
+
+/**
+ * @brief Tipo do valor obtido de uma informação por uma projeção
+ */
+template <class T, class Project> struct avl_projected {
+	typedef typename std::decay<
+		decltype(std::declval<Project>()(std::declval<const T&>()))
+	>::type type;
+};
+
+/**
+ * @brief Soma das informações
+ *
+ * @tparam T Tipo de valor armazenado na árvore
+ * @tparam Project Projeção da informação no valor somado
+ */
+template <class T, class Project = avl_identity> struct avl_sum {
+	typedef typename avl_projected<T, Project>::type value_type;
+
+	static value_type lift(const T& data) { return Project()(data); }
+	static value_type identity() { return value_type(); }
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return a + b;
+	}
+};
+
+/**
+ * @brief Menor valor das informações; o agregado vazio é o maior valor
+ *        representável
+ *
+ * @tparam T Tipo de valor armazenado na árvore
+ * @tparam Project Projeção da informação num valor numérico
+ */
+template <class T, class Project = avl_identity> struct avl_min {
+	typedef typename avl_projected<T, Project>::type value_type;
+
+	static value_type lift(const T& data) { return Project()(data); }
+
+	static value_type identity() {
+		return std::numeric_limits<value_type>::max();
+	}
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return b < a ? b : a;
+	}
+};
+
+/**
+ * @brief Maior valor das informações; o agregado vazio é o menor valor
+ *        representável
+ *
+ * @tparam T Tipo de valor armazenado na árvore
+ * @tparam Project Projeção da informação num valor numérico
+ */
+template <class T, class Project = avl_identity> struct avl_max {
+	typedef typename avl_projected<T, Project>::type value_type;
+
+	static value_type lift(const T& data) { return Project()(data); }
+
+	static value_type identity() {
+		return std::numeric_limits<value_type>::lowest();
+	}
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return a < b ? b : a;
+	}
+};
+
+/**
+ * @brief Número de informações que satisfazem um predicado
+ *
+ * @tparam T Tipo de valor armazenado na árvore
+ * @tparam Predicate Predicado sobre as informações
+ */
+template <class T, class Predicate> struct avl_count_if {
+	typedef int value_type;
+
+	static value_type lift(const T& data) { return Predicate()(data) ? 1 : 0; }
+	static value_type identity() { return 0; }
+
+	static value_type combine(value_type a, value_type b) {
+		return a + b;
+	}
+};
+
+/**
+ * @brief Primeira e última informação viva, em ordem, de cada subárvore
+ *
+ * Com este aumento, `min()` e `max()` da árvore custam O(1). Cada nó
+ * guarda cópias das duas informações, que não dependem do nó de onde
+ * vieram; para informações grandes, as cópias pesam em cada reajuste.
+ *
+ * @tparam T Tipo de valor armazenado na árvore
+ */
+template <class T> struct avl_bounds {
+	struct value_type {
+		T first;		//! Primeira informação
+		T last;			//! Última informação
+		bool present;	//! Se a subárvore tem informações vivas
+
+		value_type() : first(), last(), present(false) {}
+
+		value_type(const T& first, const T& last, bool present)
+			: first(first), last(last), present(present) {}
+	};
+
+	static value_type lift(const T& data) { return value_type(data, data, true); }
+	static value_type identity() { return value_type(); }
+
+	static value_type combine(const value_type& a, const value_type& b) {
+		return value_type(
+			a.present ? a.first : b.first,
+			b.present ? b.last : a.last,
+			a.present || b.present
+		);
+	}
+
+	/**
+	 * @brief Obtém a primeira informação de um agregado não vazio
+	 */
+	static const T& front(const value_type& v) { return v.first; }
+
+	/**
+	 * @brief Obtém a última informação de um agregado não vazio
+	 */
+	static const T& back(const value_type& v) { return v.last; }
+};
+
+#endif // AVL_TREE_AUGMENT_HPP
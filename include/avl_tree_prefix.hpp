@@ -0,0 +1,52 @@
+/**
+ * @brief Cabeçalho para os comparadores com prefixo da árvore AVL
+ *
+ * @file avl_tree_prefix.hpp
+ */
+
+#ifndef AVL_TREE_PREFIX_HPP
+#define AVL_TREE_PREFIX_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+
+#include "avl_tree.hpp"
+
+/**
+ * @brief Ordem lexicográfica de strings, com os primeiros 8 bytes de cada
+ *        chave guardados no nó
+ *
+ * O prefixo é lido em big-endian e completado com zeros, então a ordem dos
+ * prefixos como inteiros é a mesma das strings, comparadas byte a byte sem
+ * sinal como em `std::string::compare`. Uma busca compara primeiro os
+ * prefixos, que já estão no nó, e só lê a string do nó quando eles são
+ * iguais. Chaves que costumam dividir os 8 primeiros bytes, como URLs com o
+ * mesmo esquema, precisam ser normalizadas antes, sem o começo repetido,
+ * para aproveitar o prefixo.
+ *
+ * Uso:
+ *
+ *     avl_tree<std::string, avl_prefix_less<> > t;
+ *
+ * @tparam String Tipo de string, com `data()` e `size()` em bytes
+ */
+template <class String = std::string> struct avl_prefix_less : std::less<String> {
+	typedef std::uint64_t prefix_type;
+
+	/**
+	 * @brief Obtém o prefixo de uma chave
+	 */
+	static prefix_type prefix(const String& key) {
+		unsigned char b[8] = { 0 };
+		std::memcpy(b, key.data(), key.size() < 8 ? key.size() : 8);
+
+		return (prefix_type) b[0] << 56 | (prefix_type) b[1] << 48
+			| (prefix_type) b[2] << 40 | (prefix_type) b[3] << 32
+			| (prefix_type) b[4] << 24 | (prefix_type) b[5] << 16
+			| (prefix_type) b[6] << 8 | (prefix_type) b[7];
+	}
+};
+
+#endif // AVL_TREE_PREFIX_HPP
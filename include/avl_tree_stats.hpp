@@ -0,0 +1,230 @@
+/**
+ * @brief Cabeçalho para a política de instrumentação da árvore AVL
+ *
+ * @file avl_tree_stats.hpp
+ */
+
+#ifndef AVL_TREE_STATS_HPP
+#define AVL_TREE_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "avl_tree.hpp"
+
+/**
+ * @brief Histograma de latências em escala logarítmica
+ *
+ * O balde i conta as medidas com duração em [2^i, 2^(i+1)) nanossegundos.
+ */
+struct avl_latency_histogram {
+	static const int BUCKETS = 64;
+
+	unsigned long buckets[BUCKETS];
+	unsigned long count;
+
+	avl_latency_histogram() : count(0) {
+		for (int i = 0; i < BUCKETS; i++)
+			buckets[i] = 0;
+	}
+
+	/**
+	 * @brief Registra uma medida
+	 *
+	 * @param ns Duração em nanossegundos
+	 */
+	void record(uint64_t ns) {
+		int i = 0;
+
+		while (ns >>= 1)
+			i++;
+
+		buckets[i]++;
+		count++;
+	}
+
+	/**
+	 * @brief Estima um percentil das medidas
+	 *
+	 * @param p Percentil, entre 0 e 100
+	 * @return uint64_t Limite superior do balde do percentil, em ns
+	 */
+	uint64_t percentile(double p) const {
+		if (count == 0)
+			return 0;
+
+		unsigned long rank = (unsigned long) (p / 100 * count), seen = 0;
+
+		for (int i = 0; i < BUCKETS; i++) {
+			seen += buckets[i];
+
+			if (seen > rank)
+				return i < BUCKETS - 1 ? (uint64_t) 2 << i : UINT64_MAX;
+		}
+
+		return UINT64_MAX;
+	}
+};
+
+/**
+ * @brief Contadores acumulados pela política de instrumentação
+ */
+struct avl_stats_snapshot {
+	static const int RETRACE_BUCKETS = 64;
+
+	unsigned long comparisons;			//! Comparações entre informações
+	unsigned long visits;				//! Nós visitados
+	unsigned long single_rotations;		//! Rotações simples
+	unsigned long double_rotations;		//! Rotações duplas
+	unsigned long allocations;			//! Alocações de nós e informações
+	unsigned long deallocations;		//! Liberações de nós e informações
+	unsigned long retraces;				//! Soma das profundidades de reajuste
+	int max_retrace;					//! Maior profundidade de reajuste
+
+	//! Número de inserções e remoções por profundidade de reajuste
+	unsigned long retrace_depth[RETRACE_BUCKETS];
+
+	//! Latências por tipo de operação
+	avl_latency_histogram latency[AVL_OPERATIONS];
+
+	avl_stats_snapshot()
+		: comparisons(0), visits(0), single_rotations(0), double_rotations(0),
+		  allocations(0), deallocations(0), retraces(0), max_retrace(0) {
+		for (int i = 0; i < RETRACE_BUCKETS; i++)
+			retrace_depth[i] = 0;
+	}
+};
+
+/**
+ * @brief Política de instrumentação que conta os eventos da árvore
+ *
+ * Os contadores são mantidos por thread, então não há disputa entre threads
+ * e `stats()` retorna os eventos da thread que a chama. A latência e a
+ * profundidade de reajuste são registradas só na chamada mais externa de
+ * cada operação; as chamadas recursivas apenas acumulam os eventos.
+ *
+ * A profundidade de reajuste de uma inserção ou remoção é o número de nós
+ * cuja altura mudou, ou que foram rotacionados, na volta da descida.
+ *
+ * Uso:
+ *
+ *     avl_tree<int, std::less<int>, std::equal_to<int>, avl_counting_stats> t;
+ *     ...
+ *     avl_stats_snapshot s = t.stats();
+ */
+struct avl_counting_stats {
+	typedef avl_stats_snapshot snapshot;
+
+private:
+
+	/**
+	 * @brief Estado da thread
+	 */
+	struct state {
+		snapshot counters;
+		int depth;			//! Número de operações aninhadas em andamento
+		int retrace;		//! Nós reajustados na operação atual
+
+		state() : depth(0), retrace(0) {}
+	};
+
+	static state& current() {
+		static thread_local state s;
+		return s;
+	}
+
+public:
+
+	/**
+	 * @brief Marca o começo e o fim de uma operação da árvore
+	 */
+	class scope {
+	private:
+		typedef std::chrono::steady_clock clock;
+
+		avl_operation op;
+		clock::time_point start;
+
+	public:
+		explicit scope(avl_operation op) : op(op) {
+			state& s = current();
+
+			if (s.depth++ == 0) {
+				s.retrace = 0;
+				start = clock::now();
+			}
+		}
+
+		~scope() {
+			state& s = current();
+
+			if (--s.depth > 0)
+				return;
+
+			uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+				clock::now() - start
+			).count();
+
+			s.counters.latency[op].record(ns);
+
+			if (op == AVL_INSERT || op == AVL_REMOVE) {
+				int r = s.retrace < snapshot::RETRACE_BUCKETS
+					? s.retrace
+					: snapshot::RETRACE_BUCKETS - 1;
+
+				s.counters.retrace_depth[r]++;
+				s.counters.retraces += s.retrace;
+
+				if (s.retrace > s.counters.max_retrace)
+					s.counters.max_retrace = s.retrace;
+			}
+		}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+	};
+
+	static void compared() {
+		current().counters.comparisons++;
+	}
+
+	static void visited() {
+		current().counters.visits++;
+	}
+
+	static void rotated(bool twice) {
+		if (twice)
+			current().counters.double_rotations++;
+		else
+			current().counters.single_rotations++;
+	}
+
+	static void allocated() {
+		current().counters.allocations++;
+	}
+
+	static void deallocated() {
+		current().counters.deallocations++;
+	}
+
+	static void retraced(bool changed) {
+		if (changed)
+			current().retrace++;
+	}
+
+	/**
+	 * @brief Obtém uma cópia dos contadores da thread
+	 */
+	static snapshot stats() {
+		return current().counters;
+	}
+
+	/**
+	 * @brief Zera os contadores da thread
+	 */
+	static void reset() {
+		current().counters = snapshot();
+	}
+};
+
+#endif // AVL_TREE_STATS_HPP
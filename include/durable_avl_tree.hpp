@@ -0,0 +1,568 @@
+/**
+ * @brief Cabeçalho para a árvore AVL com log de escrita antecipada
+ *
+ * @file durable_avl_tree.hpp
+ */
+
+#ifndef DURABLE_AVL_TREE_HPP
+#define DURABLE_AVL_TREE_HPP
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "avl_tree.hpp"
+
+/**
+ * @brief Opções de durabilidade da árvore
+ */
+struct durability_options {
+	int group_size;				//! Registros acumulados por escrita no log
+	int fsync_interval;			//! Escritas entre cada fsync (0 = nunca)
+	int checkpoint_interval;	//! Registros entre checkpoints (0 = manual)
+
+	durability_options()
+		: group_size(64), fsync_interval(1), checkpoint_interval(0) {}
+};
+
+/**
+ * @brief Árvore AVL persistente, com log de escrita antecipada e snapshots
+ *
+ * Toda alteração entra num grupo de registros antes de ser aplicada na
+ * árvore em memória, e o grupo é gravado inteiro no arquivo `<path>.wal`
+ * quando enche. Uma gravação que falha é cortada do log e o grupo fica
+ * pendente até a próxima. O fsync é feito a cada `fsync_interval`
+ * gravações. Um checkpoint grava a árvore inteira em `<path>.snapshot` e
+ * esvazia o log. Ao ser construída, a árvore carrega o último snapshot e
+ * reaplica o final do log.
+ *
+ * Só registros completos e íntegros são reaplicados, então uma queda no meio
+ * de uma gravação perde no máximo o grupo que não chegou ao disco.
+ *
+ * @tparam T Tipo de valor armazenado na árvore, gravado byte a byte
+ */
+template <
+	class T,
+	class Compare = std::less<T>,
+	class Equal = std::equal_to<T>
+> class durable_avl_tree {
+	static_assert(
+		std::is_trivially_copyable<T>::value,
+		"durable_avl_tree requires a trivially copyable value type"
+	);
+
+public:
+
+	typedef avl_tree<T, Compare, Equal> tree_t;
+
+private:
+
+	/**
+	 * @brief Tipos de registro do log
+	 */
+	enum operation : unsigned char {
+		OP_INSERT = 1,
+		OP_UPDATE = 2,
+		OP_REMOVE = 3
+	};
+
+	static const unsigned SNAPSHOT_MAGIC = 0x4c564153;	//! "SAVL"
+
+	static const size_t RECORD_SIZE =
+		1 + sizeof(unsigned long long) + sizeof(T) + sizeof(unsigned);
+
+	tree_t tree;				//! Árvore em memória
+	durability_options opts;	//! Opções de durabilidade
+
+	std::string log_path;		//! Caminho do log
+	std::string snapshot_path;	//! Caminho do snapshot
+	int log_fd;					//! Descritor do log
+	off_t log_end;				//! Fim da parte do log gravada por inteiro
+	bool torn;					//! Se pode haver bytes parciais depois de `log_end`
+
+	std::vector<char> pending;	//! Registros ainda não gravados no log
+	int pending_records;		//! Número de registros pendentes
+	int unsynced_writes;		//! Gravações desde o último fsync
+	int since_checkpoint;		//! Registros desde o último checkpoint
+
+	unsigned long long lsn;		//! Número de sequência do último registro
+
+	/**
+	 * @brief Calcula o checksum FNV-1a de um bloco de memória
+	 */
+	static unsigned checksum(const char* data, size_t n) {
+		unsigned h = 2166136261u;
+
+		for (size_t i = 0; i < n; i++) {
+			h ^= (unsigned char) data[i];
+			h *= 16777619u;
+		}
+
+		return h;
+	}
+
+	/**
+	 * @brief Grava um bloco inteiro num descritor
+	 */
+	static void write_all(int fd, const char* data, size_t n) {
+		while (n > 0) {
+			ssize_t w = ::write(fd, data, n);
+
+			if (w < 0 && errno == EINTR)
+				continue;
+
+			if (w < 0)
+				throw "Write-ahead log write failed";
+
+			data += w;
+			n -= w;
+		}
+	}
+
+	/**
+	 * @brief Lê um arquivo inteiro para a memória
+	 *
+	 * @return true se o arquivo existe
+	 */
+	static bool read_file(const std::string & path, std::vector<char> & out) {
+		int fd = ::open(path.c_str(), O_RDONLY);
+
+		if (fd < 0)
+			return false;
+
+		char buf[1 << 16];
+		ssize_t r;
+
+		while ((r = ::read(fd, buf, sizeof buf)) > 0)
+			out.insert(out.end(), buf, buf + r);
+
+		::close(fd);
+
+		if (r < 0)
+			throw "Can't read durable tree file";
+
+		return true;
+	}
+
+	/**
+	 * @brief Sincroniza o diretório de um arquivo, para que uma renomeação
+	 *        feita nele chegue ao disco
+	 */
+	static void sync_directory(const std::string & path) {
+		size_t slash = path.rfind('/');
+		std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+
+		int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+
+		if (fd < 0)
+			throw "Can't sync snapshot directory";
+
+		int r = ::fsync(fd);
+		::close(fd);
+
+		if (r != 0)
+			throw "Can't sync snapshot directory";
+	}
+
+	/**
+	 * @brief Adiciona um registro ao grupo pendente
+	 */
+	void append(operation op, const T& data) {
+		char record[RECORD_SIZE];
+		char* p = record;
+
+		lsn++;
+
+		*p++ = op;
+		std::memcpy(p, &lsn, sizeof lsn);
+		p += sizeof lsn;
+		std::memcpy(p, &data, sizeof(T));
+		p += sizeof(T);
+
+		unsigned sum = checksum(record, p - record);
+		std::memcpy(p, &sum, sizeof sum);
+
+		pending.insert(pending.end(), record, record + RECORD_SIZE);
+		pending_records++;
+		since_checkpoint++;
+	}
+
+	/**
+	 * @brief Descarta o último registro do grupo pendente
+	 */
+	void discard_last() {
+		pending.resize(pending.size() - RECORD_SIZE);
+		pending_records--;
+		since_checkpoint--;
+		lsn--;
+	}
+
+	/**
+	 * @brief Corta do log os bytes parciais de uma gravação que falhou
+	 */
+	void cut_torn() {
+		if (::ftruncate(log_fd, log_end) != 0 || ::lseek(log_fd, log_end, SEEK_SET) < 0)
+			throw "Can't truncate write-ahead log";
+
+		torn = false;
+	}
+
+	/**
+	 * @brief Grava o grupo pendente no log, sem fsync
+	 *
+	 * Se a gravação falhar, o que chegou a ser gravado é cortado do log e o
+	 * grupo inteiro continua pendente, para ser gravado de novo depois.
+	 */
+	void write_pending() {
+		if (torn)
+			cut_torn();
+
+		try {
+			write_all(log_fd, &pending[0], pending.size());
+		} catch (const char*) {
+			torn = true;
+			cut_torn();
+			throw;
+		}
+
+		log_end += pending.size();
+		pending.clear();
+		pending_records = 0;
+	}
+
+	/**
+	 * @brief Faz o fsync do log se já houve `fsync_interval` gravações
+	 */
+	void sync_if_due() {
+		if (opts.fsync_interval > 0 && ++unsynced_writes >= opts.fsync_interval) {
+			if (::fsync(log_fd) != 0)
+				throw "Write-ahead log fsync failed";
+
+			unsynced_writes = 0;
+		}
+	}
+
+	/**
+	 * @brief Registra uma operação no grupo pendente, aplica na árvore e só
+	 *        depois grava o grupo, se ele estiver cheio
+	 *
+	 * Se a aplicação falhar, o registro ainda não saiu do grupo e é
+	 * descartado. Se a gravação falhar, a operação já está na árvore e o
+	 * grupo inteiro continua pendente, então o log e a árvore não divergem:
+	 * o erro é repassado e o grupo é gravado de novo pelo próximo `commit`.
+	 *
+	 * @param op Tipo do registro
+	 * @param data Dados do registro
+	 * @param apply Aplica a operação na árvore
+	 */
+	template <class Apply> void log_and_apply(operation op, const T& data, Apply apply) {
+		append(op, data);
+
+		try {
+			apply();
+		} catch (...) {
+			discard_last();
+			throw;
+		}
+
+		if (pending_records >= opts.group_size)
+			commit();
+
+		if (opts.checkpoint_interval > 0 &&
+			since_checkpoint >= opts.checkpoint_interval)
+			checkpoint();
+	}
+
+	/**
+	 * @brief Carrega o snapshot, se existir
+	 *
+	 * @return unsigned long long Número de sequência do snapshot
+	 */
+	unsigned long long load_snapshot() {
+		std::vector<char> data;
+
+		if (!read_file(snapshot_path, data))
+			return 0;
+
+		const size_t header = sizeof(unsigned) + 2 * sizeof(unsigned long long);
+
+		unsigned magic;
+		unsigned long long snapshot_lsn, count;
+
+		if (data.size() < header + sizeof(unsigned))
+			throw "Corrupted snapshot";
+
+		std::memcpy(&magic, &data[0], sizeof magic);
+		std::memcpy(&snapshot_lsn, &data[sizeof magic], sizeof snapshot_lsn);
+		std::memcpy(&count, &data[sizeof magic + sizeof snapshot_lsn], sizeof count);
+
+		size_t body = header + count * sizeof(T);
+		unsigned sum;
+
+		if (magic != SNAPSHOT_MAGIC || data.size() != body + sizeof sum)
+			throw "Corrupted snapshot";
+
+		std::memcpy(&sum, &data[body], sizeof sum);
+
+		if (sum != checksum(&data[0], body))
+			throw "Corrupted snapshot";
+
+		std::vector<T> items(count);
+
+		if (count > 0)
+			std::memcpy(&items[0], &data[header], count * sizeof(T));
+
+		tree.build(items.begin(), items.end());
+
+		return snapshot_lsn;
+	}
+
+	/**
+	 * @brief Reaplica os registros do log posteriores ao snapshot
+	 *
+	 * @return size_t Tamanho da parte íntegra do log
+	 */
+	size_t replay_log() {
+		std::vector<char> data;
+
+		if (!read_file(log_path, data))
+			return 0;
+
+		size_t offset = 0;
+
+		for (; offset + RECORD_SIZE <= data.size(); offset += RECORD_SIZE) {
+			const char* p = &data[offset];
+
+			unsigned sum;
+			std::memcpy(&sum, p + RECORD_SIZE - sizeof sum, sizeof sum);
+
+			if (sum != checksum(p, RECORD_SIZE - sizeof sum))
+				break;
+
+			unsigned long long record_lsn;
+			T value;
+
+			std::memcpy(&record_lsn, p + 1, sizeof record_lsn);
+			std::memcpy(&value, p + 1 + sizeof record_lsn, sizeof(T));
+
+			if (record_lsn <= lsn)
+				continue;
+
+			switch (p[0]) {
+				case OP_INSERT: tree.insert(value); break;
+				case OP_UPDATE: tree.update(value); break;
+				case OP_REMOVE: tree.remove(value); break;
+				default: throw "Corrupted write-ahead log";
+			}
+
+			lsn = record_lsn;
+			since_checkpoint++;
+		}
+
+		return offset;
+	}
+
+public:
+
+	/**
+	 * @brief Construtor, recupera o estado gravado em disco
+	 *
+	 * @param path Caminho base dos arquivos da árvore
+	 * @param options Opções de durabilidade
+	 */
+	explicit durable_avl_tree(
+		const std::string & path,
+		const durability_options & options = durability_options()
+	) : opts(options),
+		log_path(path + ".wal"),
+		snapshot_path(path + ".snapshot"),
+		log_fd(-1),
+		log_end(0),
+		torn(false),
+		pending_records(0),
+		unsynced_writes(0),
+		since_checkpoint(0),
+		lsn(0)
+	{
+		lsn = load_snapshot();
+		size_t valid = replay_log();
+
+		log_fd = ::open(log_path.c_str(), O_WRONLY | O_CREAT, 0644);
+
+		if (log_fd < 0)
+			throw "Can't open write-ahead log";
+
+		// Descarta um registro incompleto deixado por uma queda
+		if (::ftruncate(log_fd, valid) != 0 ||
+			::lseek(log_fd, valid, SEEK_SET) < 0) {
+			::close(log_fd);
+			throw "Can't open write-ahead log";
+		}
+
+		log_end = valid;
+	}
+
+	/**
+	 * @brief Destrutor, grava e sincroniza os registros pendentes
+	 */
+	~durable_avl_tree() {
+		try {
+			sync();
+		} catch (const char*) {}
+
+		::close(log_fd);
+	}
+
+	durable_avl_tree(const durable_avl_tree &) = delete;
+	durable_avl_tree & operator = (const durable_avl_tree &) = delete;
+
+	/**
+	 * @brief Obtém a árvore em memória
+	 *
+	 * @return const tree_t& A árvore
+	 */
+	const tree_t & get_tree() const {
+		return tree;
+	}
+
+	/**
+	 * @brief Obtém a quantidade de elementos da árvore
+	 *
+	 * @return int a quantidade de elementos da árvore
+	 */
+	int size() const {
+		return tree.size();
+	}
+
+	/**
+	 * @brief Determina se uma informação existe na árvore
+	 *
+	 * @param data Dados a serem procurados
+	 */
+	bool includes(const T& data) const {
+		return tree.includes(data);
+	}
+
+	/**
+	 * @brief Insere uma informação na árvore e registra no log
+	 *
+	 * @param data Dados a serem inseridos na árvore
+	 */
+	void insert(const T& data) {
+		if (tree.includes(data))
+			throw "Repeated information";
+
+		log_and_apply(OP_INSERT, data, [&] { tree.insert(data); });
+	}
+
+	/**
+	 * @brief Atualiza uma informação na árvore e registra no log
+	 *
+	 * @param data Dados a serem atualizados na árvore
+	 */
+	void update(const T& data) {
+		log_and_apply(OP_UPDATE, data, [&] { tree.update(data); });
+	}
+
+	/**
+	 * @brief Remove uma informação da árvore e registra no log
+	 *
+	 * @param data Informação a ser removida
+	 */
+	void remove(const T& data) {
+		if (!tree.includes(data))
+			throw "Information not found";
+
+		log_and_apply(OP_REMOVE, data, [&] { tree.remove(data); });
+	}
+
+	/**
+	 * @brief Grava no log o grupo de registros pendentes
+	 *
+	 * O fsync só é feito a cada `fsync_interval` gravações.
+	 */
+	void commit() {
+		if (pending.empty())
+			return;
+
+		write_pending();
+		sync_if_due();
+	}
+
+	/**
+	 * @brief Grava os registros pendentes e força a sincronização com o disco
+	 */
+	void sync() {
+		commit();
+
+		if (::fsync(log_fd) != 0)
+			throw "Write-ahead log fsync failed";
+
+		unsynced_writes = 0;
+	}
+
+	/**
+	 * @brief Grava um snapshot da árvore e esvazia o log
+	 *
+	 * O snapshot é gravado num arquivo temporário e renomeado, então uma
+	 * queda durante o checkpoint mantém o snapshot anterior e o log.
+	 */
+	void checkpoint() {
+		sync();
+
+		std::vector<char> data;
+		unsigned magic = SNAPSHOT_MAGIC;
+		unsigned long long count = tree.size();
+
+		data.reserve(sizeof magic + 2 * sizeof lsn + count * sizeof(T) + sizeof magic);
+		data.insert(data.end(), (char*) &magic, (char*) &magic + sizeof magic);
+		data.insert(data.end(), (char*) &lsn, (char*) &lsn + sizeof lsn);
+		data.insert(data.end(), (char*) &count, (char*) &count + sizeof count);
+
+		for (auto it = tree.begin_in_order(); it != tree.end_in_order(); ++it)
+			data.insert(data.end(), (const char*) &*it, (const char*) &*it + sizeof(T));
+
+		unsigned sum = checksum(&data[0], data.size());
+		data.insert(data.end(), (char*) &sum, (char*) &sum + sizeof sum);
+
+		std::string tmp_path = snapshot_path + ".tmp";
+		int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+		if (fd < 0)
+			throw "Can't write snapshot";
+
+		try {
+			write_all(fd, &data[0], data.size());
+		} catch (const char*) {
+			::close(fd);
+			throw "Can't write snapshot";
+		}
+
+		if (::fsync(fd) != 0 || ::close(fd) != 0)
+			throw "Can't write snapshot";
+
+		if (std::rename(tmp_path.c_str(), snapshot_path.c_str()) != 0)
+			throw "Can't write snapshot";
+
+		// O log só pode ser esvaziado depois que a renomeação chegou ao disco
+		sync_directory(snapshot_path);
+
+		// Registros já cobertos pelo snapshot são ignorados na recuperação,
+		// então uma queda antes de esvaziar o log não duplica operações
+		if (::ftruncate(log_fd, 0) != 0 || ::lseek(log_fd, 0, SEEK_SET) < 0)
+			throw "Can't truncate write-ahead log";
+
+		log_end = 0;
+
+		since_checkpoint = 0;
+	}
+};
+
+#endif // DURABLE_AVL_TREE_HPP
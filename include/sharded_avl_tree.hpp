@@ -0,0 +1,399 @@
+/**
+ * @brief Cabeçalho para a árvore AVL particionada por intervalos de chaves
+ *
+ * @file sharded_avl_tree.hpp
+ */
+
+#ifndef SHARDED_AVL_TREE_HPP
+#define SHARDED_AVL_TREE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "avl_tree.hpp"
+
+/**
+ * @brief Opções de particionamento da árvore
+ */
+struct sharding_options {
+	int split_size;		//! Tamanho a partir do qual um shard é dividido
+	int join_size;		//! Tamanho abaixo do qual um shard é juntado ao vizinho
+	int max_shards;		//! Número máximo de shards
+
+	sharding_options()
+		: split_size(1 << 16), join_size(1 << 12), max_shards(256) {}
+};
+
+/**
+ * @brief Árvore AVL particionada em shards por intervalos de chaves
+ *
+ * Cada shard é uma `avl_tree` independente, com a sua própria trava, e
+ * guarda as informações de um intervalo de chaves. Uma tabela de rotas,
+ * com o menor valor de cada shard, leva cada operação ao seu shard por
+ * busca binária, então operações em shards diferentes não disputam a mesma
+ * trava.
+ *
+ * Um shard que passa de `split_size` elementos é dividido pela informação
+ * da sua raiz, que fica perto da mediana, com `extract_range`; um shard
+ * que fica menor que `join_size` é juntado ao vizinho com `merge`. Nos
+ * dois casos os nós são movidos, sem realocação.
+ *
+ * A tabela de rotas nunca é alterada: cada mudança publica uma nova. Um
+ * leitor que usou uma tabela velha percebe ao travar o shard, pela versão
+ * dele, e tenta de novo. Cada leitor segura a tabela que usa por um
+ * `std::shared_ptr`, então uma tabela velha, junto com os shards que só
+ * ela ainda guarda, é liberada quando o último leitor a solta.
+ *
+ * @tparam T Tipo de valor armazenado na árvore
+ */
+template <
+	class T,
+	class Compare = std::less<T>,
+	class Equal = std::equal_to<T>
+> class sharded_avl_tree {
+public:
+
+	typedef avl_tree<T, Compare, Equal> tree_t;
+
+private:
+
+	/**
+	 * @brief Partição da árvore
+	 */
+	struct shard {
+		std::mutex lock;	//! Trava do shard
+		tree_t tree;		//! Informações do intervalo do shard
+		unsigned version;	//! Muda sempre que o intervalo do shard muda
+
+		shard() : version(0) {}
+	};
+
+	/**
+	 * @brief Tabela de rotas, imutável depois de publicada
+	 */
+	struct routing {
+		std::vector<T> bounds;			//! Menor informação de cada shard, a partir do segundo
+		std::vector<std::shared_ptr<shard> > shards;	//! Shards em ordem de intervalo
+		std::vector<unsigned> versions;	//! Versão de cada shard na publicação
+	};
+
+	typedef std::shared_ptr<const routing> routing_ptr;
+
+	sharding_options opts;		//! Opções de particionamento
+	routing_ptr table;			//! Tabela de rotas atual, só acessada atomicamente
+	std::mutex resize;			//! Serializa divisões, junções e percursos
+	std::atomic<int> count;		//! Número de elementos
+
+	/**
+	 * @brief Obtém a posição do shard de uma informação numa tabela
+	 */
+	static size_t route(const routing& r, const T& data) {
+		return std::upper_bound(r.bounds.begin(), r.bounds.end(), data, Compare())
+			- r.bounds.begin();
+	}
+
+	/**
+	 * @brief Obtém a tabela de rotas atual, que fica viva enquanto for usada
+	 */
+	routing_ptr current() const {
+		return std::atomic_load(&table);
+	}
+
+	/**
+	 * @brief Publica uma nova tabela de rotas
+	 */
+	void publish(routing* next) {
+		std::atomic_store(&table, routing_ptr(next));
+	}
+
+	/**
+	 * @brief Trava o shard de uma informação
+	 *
+	 * @param data Informação
+	 * @param guard Recebe a trava do shard
+	 * @return shard* O shard, cujo intervalo contém a informação
+	 */
+	shard* acquire(const T& data, std::unique_lock<std::mutex> & guard) const {
+		for (;;) {
+			routing_ptr r = current();
+			size_t i = route(*r, data);
+			shard* s = r->shards[i].get();
+
+			std::unique_lock<std::mutex> l(s->lock);
+
+			// O intervalo não mudou desde a publicação da tabela. Então o
+			// shard está na tabela atual, e só sai dela numa junção, que
+			// precisa da sua trava
+			if (s->version == r->versions[i]) {
+				guard = std::move(l);
+				return s;
+			}
+		}
+	}
+
+	/**
+	 * @brief Divide ou junta o shard de uma informação, se ele estiver
+	 *        grande ou pequeno demais
+	 *
+	 * Se outra thread estiver mudando os shards, nada é feito; a próxima
+	 * operação no shard tenta de novo.
+	 *
+	 * @param data Informação do shard
+	 */
+	void rebalance(const T& data) {
+		std::unique_lock<std::mutex> guard(resize, std::try_to_lock);
+
+		if (!guard.owns_lock())
+			return;
+
+		// Com `resize` travado, a tabela não muda. Ela é mantida até o fim,
+		// então um shard retirado por `join` só é liberado depois dele
+		routing_ptr r = current();
+		size_t i = route(*r, data);
+
+		std::unique_lock<std::mutex> l(r->shards[i]->lock);
+		int n = r->shards[i]->tree.size();
+
+		if (n > opts.split_size && (int) r->shards.size() < opts.max_shards) {
+			split(*r, i);
+
+		} else if (n < opts.join_size && r->shards.size() > 1) {
+			l.unlock();
+			join(*r, i);
+		}
+	}
+
+	/**
+	 * @brief Divide um shard travado em dois pela informação da sua raiz
+	 *
+	 * @param r Tabela atual
+	 * @param i Posição do shard
+	 */
+	void split(const routing& r, size_t i) {
+		shard* s = r.shards[i].get();
+		T key = s->tree.get_info();
+
+		// A raiz só é a menor informação em árvores muito pequenas
+		if (!Compare()(s->tree.min(), key))
+			return;
+
+		std::shared_ptr<shard> fresh = std::make_shared<shard>();
+		fresh->tree = s->tree.extract_range(key, s->tree.max());
+
+		s->version++;
+
+		routing* next = new routing(r);
+		next->bounds.insert(next->bounds.begin() + i, key);
+		next->shards.insert(next->shards.begin() + i + 1, fresh);
+		next->versions[i] = s->version;
+		next->versions.insert(next->versions.begin() + i + 1, fresh->version);
+
+		publish(next);
+	}
+
+	/**
+	 * @brief Junta um shard ao vizinho, se os dois juntos ainda forem
+	 *        pequenos
+	 *
+	 * @param r Tabela atual
+	 * @param i Posição do shard
+	 */
+	void join(const routing& r, size_t i) {
+		size_t a = i + 1 < r.shards.size() ? i : i - 1, b = a + 1;
+		shard* low = r.shards[a].get();
+		shard* high = r.shards[b].get();
+
+		// Travas sempre em ordem de posição
+		std::lock_guard<std::mutex> la(low->lock);
+		std::lock_guard<std::mutex> lb(high->lock);
+
+		// Folga para que o shard juntado não seja logo dividido de novo
+		if (low->tree.size() + high->tree.size() > opts.split_size / 2)
+			return;
+
+		low->tree.merge(high->tree);
+
+		low->version++;
+		high->version++;
+
+		routing* next = new routing(r);
+		next->bounds.erase(next->bounds.begin() + a);
+		next->shards.erase(next->shards.begin() + b);
+		next->versions.erase(next->versions.begin() + b);
+		next->versions[a] = low->version;
+
+		publish(next);
+	}
+
+public:
+
+	/**
+	 * @brief Construtor, com um único shard
+	 *
+	 * @param options Opções de particionamento
+	 */
+	explicit sharded_avl_tree(
+		const sharding_options & options = sharding_options()
+	) : opts(options), count(0) {
+		routing* r = new routing();
+		r->shards.push_back(std::make_shared<shard>());
+		r->versions.push_back(0);
+
+		publish(r);
+	}
+
+	/**
+	 * @brief Construtor, com os shards já divididos
+	 *
+	 * @param bounds Menor informação de cada shard a partir do segundo, em
+	 *        ordem estritamente crescente
+	 * @param options Opções de particionamento
+	 */
+	explicit sharded_avl_tree(
+		const std::vector<T> & bounds,
+		const sharding_options & options = sharding_options()
+	) : opts(options), count(0) {
+		for (size_t i = 1; i < bounds.size(); i++)
+			if (!Compare()(bounds[i - 1], bounds[i]))
+				throw "Unsorted sequence";
+
+		routing* r = new routing();
+		r->bounds = bounds;
+
+		for (size_t i = 0; i <= bounds.size(); i++) {
+			r->shards.push_back(std::make_shared<shard>());
+			r->versions.push_back(0);
+		}
+
+		publish(r);
+	}
+
+	sharded_avl_tree(const sharded_avl_tree &) = delete;
+	sharded_avl_tree & operator = (const sharded_avl_tree &) = delete;
+
+	/**
+	 * @brief Obtém a quantidade de elementos da árvore
+	 *
+	 * @return int a quantidade de elementos da árvore
+	 */
+	int size() const {
+		return count.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief Obtém o número atual de shards
+	 *
+	 * @return int o número de shards
+	 */
+	int shard_count() const {
+		return (int) current()->shards.size();
+	}
+
+	/**
+	 * @brief Insere uma informação na árvore
+	 *
+	 * @param data Dados a serem inseridos na árvore
+	 */
+	void insert(const T& data) {
+		std::unique_lock<std::mutex> guard;
+		shard* s = acquire(data, guard);
+
+		s->tree.insert(data);
+		count++;
+
+		bool full = s->tree.size() > opts.split_size;
+		guard.unlock();
+
+		if (full)
+			rebalance(data);
+	}
+
+	/**
+	 * @brief Atualiza uma informação na árvore, inserindo se não existir
+	 *
+	 * @param data Dados a serem atualizados na árvore
+	 */
+	void update(const T& data) {
+		std::unique_lock<std::mutex> guard;
+		shard* s = acquire(data, guard);
+
+		int before = s->tree.size();
+		s->tree.update(data);
+
+		if (s->tree.size() > before)
+			count++;
+
+		bool full = s->tree.size() > opts.split_size;
+		guard.unlock();
+
+		if (full)
+			rebalance(data);
+	}
+
+	/**
+	 * @brief Remove uma informação da árvore
+	 *
+	 * @param data Informação a ser removida
+	 */
+	void remove(const T& data) {
+		std::unique_lock<std::mutex> guard;
+		shard* s = acquire(data, guard);
+
+		s->tree.remove(data);
+		count--;
+
+		bool sparse = s->tree.size() < opts.join_size;
+		guard.unlock();
+
+		if (sparse)
+			rebalance(data);
+	}
+
+	/**
+	 * @brief Busca uma informação na árvore
+	 *
+	 * @param data Dados a serem procurados, que recebem a informação
+	 *        encontrada
+	 */
+	bool find(T& data) const {
+		std::unique_lock<std::mutex> guard;
+		return acquire(data, guard)->tree.find(data);
+	}
+
+	/**
+	 * @brief Determina se uma informação existe na árvore
+	 *
+	 * @param data Dados a serem procurados
+	 */
+	bool includes(const T& data) const {
+		std::unique_lock<std::mutex> guard;
+		return acquire(data, guard)->tree.includes(data);
+	}
+
+	/**
+	 * @brief Percorre todas as informações em ordem
+	 *
+	 * Como os shards guardam intervalos disjuntos, a ordem global é a
+	 * concatenação dos shards na ordem da tabela. Cada shard fica travado
+	 * enquanto é percorrido, e as divisões e junções esperam o fim do
+	 * percurso. A função não pode alterar esta árvore.
+	 *
+	 * @param fn Função chamada com cada informação
+	 */
+	template <class Function> void for_each(Function fn) {
+		std::lock_guard<std::mutex> guard(resize);
+		routing_ptr r = current();
+
+		for (const std::shared_ptr<shard>& s : r->shards) {
+			std::lock_guard<std::mutex> l(s->lock);
+
+			for (auto it = s->tree.begin_in_order(); it != s->tree.end_in_order(); ++it)
+				fn(*it);
+		}
+	}
+};
+
+#endif // SHARDED_AVL_TREE_HPP
@@ -1,32 +1,417 @@
 #include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <string>
-#include <stack>
-#include <regex>
+#include <vector>
 
 #include <avl_tree.hpp>
 
 using namespace std;
-using namespace regex_constants;
 
-static const regex INSERT(R"(^\s*(?:i|insert)\s*(\d+)\s*$)", icase | optimize);
-static const regex REMOVE(R"(^\s*(?:r|remove)\s*(\d+)\s*$)", icase | optimize);
-static const regex PRINT(R"(^\s*(?:p|print)\s*(in|pre|post|level)?\s*$)", icase | optimize);
-static const regex CLEAR(R"(^\s*(?:c|r|clear|reset)\s*$)", icase | optimize);
-static const regex SAVE(R"(^\s*(?:s|save)\s+([^\\\?%\*]+)\s*$)", icase | optimize);
-static const regex SAVEGV(R"(^\s*(?:g|graphviz)\s+([^\\\?%\*]+)\s*$)", icase | optimize);
-static const regex QUIT(R"(^\s*(?:q|quit|exit)\s*$)", icase | optimize);
+/**
+ * @brief Tipos de comando do interpretador
+ */
+enum command_kind {
+    CMD_NONE,       //! Linha vazia ou comentário
+    CMD_INSERT,
+    CMD_REMOVE,
+    CMD_PRINT,
+    CMD_SAVE,
+    CMD_LOAD,
+    CMD_SAVEGV,
+    CMD_CLEAR,
+    CMD_QUIT,
+    CMD_INVALID
+};
 
 /**
- * @brief Ponto de entrada
- * 
- * @param argc Número de argumentos da linha de comando
- * @param argv Valores dos argumentos da linha de comando
+ * @brief Comando lido de uma linha
+ */
+struct command {
+    command_kind kind;
+    int value;                          //! Valor de insert e remove
+    avl_tree<int>::traversal order;     //! Ordem de print
+    string path;                        //! Arquivo de save, load e graphviz
+};
+
+/**
+ * @brief Pula os espaços de uma linha
+ */
+static const char* skip_spaces(const char* p) {
+    while (isspace((unsigned char) *p))
+        p++;
+
+    return p;
+}
+
+/**
+ * @brief Lê um inteiro não negativo em decimal, sem estouro
+ *
+ * @param p Posição na linha, avançada até o fim do número
+ * @param value Valor lido
+ * @return true se um valor válido foi lido
+ * @return false caso contrário
+ */
+static bool read_number(const char* & p, int& value) {
+    if (!isdigit((unsigned char) *p))
+        return false;
+
+    long long v = 0;
+
+    for (; isdigit((unsigned char) *p); p++) {
+        v = v * 10 + (*p - '0');
+
+        if (v > 2147483647)
+            return false;
+    }
+
+    value = (int) v;
+    return true;
+}
+
+/**
+ * @brief Determina se uma palavra, já em minúsculas, é uma das opções
+ */
+static bool is_any(const string& word, const char* a, const char* b, const char* c = "", const char* d = "") {
+    return word == a || word == b || (*c && word == c) || (*d && word == d);
+}
+
+/**
+ * @brief Interpreta uma linha de comando, sem expressões regulares
+ *
+ * Os comandos não diferenciam maiúsculas e minúsculas, e o espaço entre o
+ * comando e o número é opcional, como em `i5`.
+ *
+ * @param line Linha lida
+ * @param cmd Comando interpretado
+ */
+static void parse_command(const string& line, command& cmd) {
+    const char* p = skip_spaces(line.c_str());
+    string word;
+
+    cmd.kind = CMD_INVALID;
+
+    if (*p == '\0' || *p == '#') {
+        cmd.kind = CMD_NONE;
+        return;
+    }
+
+    for (; isalpha((unsigned char) *p); p++)
+        word += (char) tolower((unsigned char) *p);
+
+    const char* rest = skip_spaces(p);
+
+    if (is_any(word, "i", "insert") || is_any(word, "r", "remove")) {
+        // `r` sozinho limpa a árvore
+        if (word == "r" && *rest == '\0') {
+            cmd.kind = CMD_CLEAR;
+            return;
+        }
+
+        if (read_number(rest, cmd.value) && *skip_spaces(rest) == '\0')
+            cmd.kind = word[0] == 'i' ? CMD_INSERT : CMD_REMOVE;
+
+    } else if (is_any(word, "p", "print")) {
+        string mode;
+
+        for (; isalpha((unsigned char) *rest); rest++)
+            mode += (char) tolower((unsigned char) *rest);
+
+        if (*skip_spaces(rest) != '\0')
+            return;
+
+        cmd.kind = CMD_PRINT;
+
+        if (mode.empty() || mode == "sorted" || mode == "in")
+            cmd.order = avl_tree<int>::in_order;
+        else if (mode == "pre")
+            cmd.order = avl_tree<int>::pre_order;
+        else if (mode == "post")
+            cmd.order = avl_tree<int>::post_order;
+        else if (mode == "level")
+            cmd.order = avl_tree<int>::level_order;
+        else
+            cmd.kind = CMD_INVALID;
+
+    } else if (is_any(word, "c", "clear", "reset")) {
+        if (*rest == '\0')
+            cmd.kind = CMD_CLEAR;
+
+    } else if (is_any(word, "q", "e", "quit", "exit")) {
+        if (*rest == '\0')
+            cmd.kind = CMD_QUIT;
+
+    } else if (is_any(word, "s", "save", "l", "load") || is_any(word, "g", "graphviz")) {
+        // O nome do arquivo vem separado do comando por espaços
+        if (rest == p || *rest == '\0' || strpbrk(rest, "\\?%*"))
+            return;
+
+        cmd.path = rest;
+        cmd.path.erase(cmd.path.find_last_not_of(" \t\r\n") + 1);
+
+        if (word[0] == 's')
+            cmd.kind = CMD_SAVE;
+        else if (word[0] == 'l')
+            cmd.kind = CMD_LOAD;
+        else
+            cmd.kind = CMD_SAVEGV;
+    }
+}
+
+/**
+ * @brief Executa um comando na árvore
+ *
+ * @param tree Árvore
+ * @param cmd Comando, que não é CMD_NONE, CMD_QUIT nem CMD_INVALID
+ */
+static void execute(avl_tree<int>& tree, const command& cmd) {
+    switch (cmd.kind) {
+    case CMD_INSERT:
+        tree.insert(cmd.value);
+        break;
+
+    case CMD_REMOVE:
+        tree.remove(cmd.value);
+        break;
+
+    case CMD_PRINT:
+        tree.dump(cout, cmd.order);
+        break;
+
+    case CMD_SAVE: {
+        ofstream f(cmd.path, ios::binary);
+        f << tree;
+        break;
+    }
+
+    case CMD_LOAD: {
+        ifstream f(cmd.path, ios::binary);
+        f >> tree;
+        break;
+    }
+
+    case CMD_SAVEGV: {
+        ofstream f(cmd.path);
+        tree.gv_save(f);
+        break;
+    }
+
+    case CMD_CLEAR:
+        tree.clear();
+        break;
+
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Executor de scripts, que agrupa inserções e remoções seguidas
+ *
+ * Um grupo de inserções é ordenado e inserido com `build`, se a árvore
+ * estiver vazia, ou com `insert_hint` a partir da inserção anterior. Um
+ * grupo de remoções é ordenado, e cada sequência de valores consecutivos
+ * sai com um único `erase_range`. O resultado é o mesmo de executar os
+ * comandos um a um; as falhas de um grupo são contadas juntas.
+ */
+class batch_runner {
+private:
+    avl_tree<int>& tree;
+    command_kind group;         //! Tipo dos comandos agrupados
+    vector<int> values;         //! Valores dos comandos agrupados
+
+public:
+    unsigned long commands;     //! Comandos executados
+    unsigned long errors;       //! Comandos que falharam
+
+    explicit batch_runner(avl_tree<int>& tree)
+        : tree(tree), group(CMD_NONE), commands(0), errors(0) {}
+
+    /**
+     * @brief Executa o grupo pendente
+     */
+    void flush() {
+        if (values.empty())
+            return;
+
+        size_t n = values.size();
+
+        sort(values.begin(), values.end());
+        values.erase(unique(values.begin(), values.end()), values.end());
+
+        size_t done = 0;
+
+        if (group == CMD_INSERT && tree.empty()) {
+            tree.build(values.begin(), values.end());
+            done = values.size();
+
+        } else if (group == CMD_INSERT) {
+            auto hint = tree.end_in_order();
+
+            for (int v : values) {
+                try {
+                    hint = tree.insert_hint(hint, v);
+                    done++;
+                } catch (const char*) {}
+            }
+
+        } else {
+            for (size_t i = 0; i < values.size(); ) {
+                size_t j = i + 1;
+
+                while (j < values.size() && values[j] == values[j - 1] + 1)
+                    j++;
+
+                done += tree.erase_range(values[i], values[j - 1]);
+                i = j;
+            }
+        }
+
+        if (done < n) {
+            errors += n - done;
+            cerr << "Err: " << n - done << " of " << n
+                 << (group == CMD_INSERT ? " inserts failed\n" : " removes failed\n");
+        }
+
+        values.clear();
+        group = CMD_NONE;
+    }
+
+    /**
+     * @brief Executa um comando, ou acrescenta ao grupo pendente
+     *
+     * @param cmd Comando
+     * @param where Origem do comando, para as mensagens de erro
+     * @return false se o comando for de saída
+     */
+    bool run(const command& cmd, const string& where) {
+        if (cmd.kind == CMD_NONE)
+            return true;
+
+        if (cmd.kind == CMD_QUIT) {
+            flush();
+            return false;
+        }
+
+        commands++;
+
+        if (cmd.kind == CMD_INSERT || cmd.kind == CMD_REMOVE) {
+            if (cmd.kind != group)
+                flush();
+
+            group = cmd.kind;
+            values.push_back(cmd.value);
+            return true;
+        }
+
+        flush();
+
+        if (cmd.kind == CMD_INVALID) {
+            errors++;
+            cerr << where << ": Err: Invalid command\n";
+            return true;
+        }
+
+        try {
+            execute(tree, cmd);
+        } catch (const char* msg) {
+            errors++;
+            cerr << where << ": Err: " << msg << '\n';
+        }
+
+        return true;
+    }
+};
+
+/**
+ * @brief Executa os comandos de uma stream em modo de script
+ *
+ * @param in Stream de entrada
+ * @param name Nome da entrada, para as mensagens de erro
+ * @param runner Executor
+ * @return false se a entrada terminou com um comando de saída
+ */
+static bool run_script(istream& in, const string& name, batch_runner& runner) {
+    string line;
+    command cmd;
+    unsigned long number = 0;
+
+    while (getline(in, line)) {
+        number++;
+        parse_command(line, cmd);
+
+        if (!runner.run(cmd, name + ":" + to_string(number)))
+            return false;
+    }
+
+    runner.flush();
+    return true;
+}
+
+/**
+ * @brief Modo de script: executa os comandos dos arquivos, ou da entrada
+ *        padrão, sem prompt, e relata a vazão no fim
+ *
+ * @param files Arquivos de comandos; `-` é a entrada padrão
  * @return int Código de retorno
  */
-int main(int argc, char** argv) {
+static int batch(vector<string> files) {
+    ios::sync_with_stdio(false);
+
+    if (files.empty())
+        files.push_back("-");
+
+    avl_tree<int> tree;
+    batch_runner runner(tree);
+
+    auto start = chrono::steady_clock::now();
+
+    for (const string& file : files) {
+        if (file == "-") {
+            if (!run_script(cin, "stdin", runner))
+                break;
+
+            continue;
+        }
+
+        ifstream f(file);
+
+        if (!f) {
+            cerr << "Err: Can't open `" << file << "'\n";
+            return 1;
+        }
+
+        if (!run_script(f, file, runner))
+            break;
+    }
+
+    cout.flush();
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    char report[160];
+
+    snprintf(report, sizeof report,
+        "%lu commands, %lu errors, %.3f s, %.0f commands/s, %d elements\n",
+        runner.commands, runner.errors, seconds,
+        seconds > 0 ? runner.commands / seconds : 0.0, tree.size());
+
+    cerr << report;
+
+    return runner.errors > 0 ? 2 : 0;
+}
+
+/**
+ * @brief Modo interativo
+ *
+ * @return int Código de retorno
+ */
+static int interactive() {
     string line;
-    smatch m;
+    command cmd;
 
     avl_tree<int> tree;
 
@@ -36,8 +421,9 @@ int main(int argc, char** argv) {
 
     cout << "i|insert x                 : Insert X" << endl;
     cout << "r|remove x                 : Remove X" << endl;
-    cout << "p|print [(sorted|level)]   : Print out" << endl;
+    cout << "p|print [order]            : Print out (sorted|pre|post|level)" << endl;
     cout << "s|save <filename>          : Save to file" << endl;
+    cout << "l|load <filename>          : Load from file" << endl;
     cout << "g|graphviz <filename>      : Save Graphviz model to file" << endl;
     cout << "c|r|clear|reset            : Reset" << endl;
     cout << "q|e|quit|exit              : Quit" << endl;
@@ -48,92 +434,53 @@ int main(int argc, char** argv) {
     for (;;) {
 
         cout << "avl (" << tree.size() << ")> ";
-        getline(cin, line);
 
-        // Encerra o programa
-        if (regex_match(line, QUIT)) {
+        if (!getline(cin, line))
             break;
 
-        // Insere um valor na árvore
-        } else if (regex_search(line, m, INSERT)) {
-            int n = stoi(m[1]);
-
-            try {
-                tree.insert(n);
-            } catch (const char* msg) {
-                cerr << "Err: " << msg << endl;
-            }
+        parse_command(line, cmd);
 
-        // Remove um valor da árvore
-        } else if (regex_search(line, m, REMOVE)) {
-            int n = stoi(m[1]);
-            
-            try {
-                tree.remove(n);
-            } catch (const char* msg) {
-                cerr << "Err: " << msg << endl;
-            }
+        // Encerra o programa
+        if (cmd.kind == CMD_QUIT)
+            break;
 
-        // Escreve a árvore na tela
-        } else if (regex_search(line, m, PRINT)) {
-            string mode = m[1];
-
-            if (mode.empty())
-                mode = "sorted";
-
-            transform(
-                mode.begin(), mode.end(), 
-                mode.begin(), 
-                ::tolower
-            );
-
-            // Escreve os elementos da árvore em ordem
-            if (mode == "sorted") {
-                for (auto it = tree.begin_in_order(); it != tree.end_in_order(); it++)
-                    cout << *it << " ";
-
-                cout << endl;
-
-            // Escreve os elementos da árvore por nível
-            } else if (mode == "level") {
-                int level = 0;
-
-                for (auto it = tree.begin_by_level(); it != tree.end_by_level(); it++) {
-                    if (level != it.level()) {
-                        cout << endl;
-                        level = it.level();
-                    }
-
-                    cout << *it << " ";
-                }
-
-                cout << endl;
-
-            } else
-                cerr << "Err: Invalid printing mode `" << mode << "'" << endl;
-        
-        // Salva a árvore num arquivo
-        } else if (regex_search(line, m, SAVE)) {
-            ofstream f(m[1], ios::binary);
-            f << tree;
-            f.close();
-            
-        // Salva a árvore como modelo do graphviz num arquivo
-        } else if (regex_search(line, m, SAVEGV)) {
-            ofstream f(m[1]);
-            tree.gv_save(f);
-            f.close();
-            
-        // Limpa a árvore
-        } else if (regex_match(line, CLEAR)) {
-            tree.clear();
+        if (cmd.kind == CMD_NONE)
+            continue;
 
         // Comando inválido
-        } else {
+        if (cmd.kind == CMD_INVALID) {
             cerr << "Err: Invalid command" << endl;
             continue;
         }
+
+        try {
+            execute(tree, cmd);
+        } catch (const char* msg) {
+            cerr << "Err: " << msg << endl;
+        }
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Ponto de entrada
+ *
+ * Sem argumentos, abre o modo interativo. Com `-b` ou `--batch`, executa os
+ * arquivos de comandos seguintes (ou a entrada padrão) em modo de script.
+ *
+ * @param argc Número de argumentos da linha de comando
+ * @param argv Valores dos argumentos da linha de comando
+ * @return int Código de retorno
+ */
+int main(int argc, char** argv) {
+    if (argc > 1 && (string(argv[1]) == "-b" || string(argv[1]) == "--batch"))
+        return batch(vector<string>(argv + 2, argv + argc));
+
+    if (argc > 1) {
+        cerr << "Usage: " << argv[0] << " [-b|--batch [file...]]" << endl;
+        return 1;
+    }
+
+    return interactive();
+}
@@ -0,0 +1,119 @@
+#include <avl_interval_tree.hpp>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+
+typedef avl_interval_tree<int> interval_tree;
+typedef interval_tree::interval interval;
+
+/**
+ * @brief Busca os intervalos sobrepostos a [a, b] percorrendo todos
+ */
+static std::vector<interval> linear_overlapping(
+    const std::set<interval>& model,
+    int a,
+    int b
+) {
+    std::vector<interval> found;
+
+    for (const interval& i : model)
+        if (i.overlaps(a, b))
+            found.push_back(i);
+
+    return found;
+}
+
+TEST(Interval, Empty) {
+    interval_tree t;
+
+    EXPECT_TRUE(t.overlapping(0, 100).empty());
+    ASSERT_TRUE(t.stab(0).empty());
+}
+
+TEST(Interval, Invalid) {
+    interval_tree t;
+
+    ASSERT_ANY_THROW(t.insert(5, 4));
+    ASSERT_EQ(t.size(), 0);
+}
+
+TEST(Interval, Stab) {
+    interval_tree t;
+
+    t.insert(0, 10);
+    t.insert(5, 5);
+    t.insert(5, 20);
+    t.insert(11, 12);
+    t.insert(-3, -1);
+
+    std::vector<interval> at5 = t.stab(5);
+    ASSERT_EQ(at5.size(), 3u);
+    EXPECT_EQ(at5[0], interval(0, 10));
+    EXPECT_EQ(at5[1], interval(5, 5));
+    EXPECT_EQ(at5[2], interval(5, 20));
+
+    // Os extremos fazem parte do intervalo
+    EXPECT_EQ(t.stab(10).size(), 2u);
+    EXPECT_EQ(t.stab(-1).size(), 1u);
+    EXPECT_TRUE(t.stab(21).empty());
+
+    t.remove(5, 20);
+    ASSERT_EQ(t.stab(12).size(), 1u);
+}
+
+TEST(Interval, Overlapping) {
+    interval_tree t;
+
+    for (int i = 0; i < 100; i++)
+        t.insert(i * 10, i * 10 + 5);
+
+    std::vector<interval> found = t.overlapping(36, 52);
+    ASSERT_EQ(found.size(), 2u);
+    EXPECT_EQ(found[0], interval(40, 45));
+    EXPECT_EQ(found[1], interval(50, 55));
+
+    EXPECT_EQ(t.overlapping(33, 38).size(), 1u);
+    EXPECT_TRUE(t.overlapping(46, 49).empty());
+
+    int count = 0;
+    t.overlapping(0, 1000, [&](const interval&) { count++; });
+    ASSERT_EQ(count, 100);
+}
+
+TEST(Interval, Random) {
+    std::mt19937 rng(23);
+    std::set<interval> model;
+    interval_tree t;
+
+    for (int step = 0; step < 3000; step++) {
+        int low = (int) (rng() % 2000), high = low + (int) (rng() % 300);
+
+        if (rng() % 4 == 0 && !model.empty()) {
+            auto it = model.lower_bound(interval(low, low));
+
+            if (it != model.end()) {
+                t.remove(it->low, it->high);
+                model.erase(it);
+            }
+
+        } else if (!model.count(interval(low, high))) {
+            t.insert(low, high);
+            model.insert(interval(low, high));
+        }
+
+        if (step % 50 == 0) {
+            int a = (int) (rng() % 2400) - 100, b = a + (int) (rng() % 50);
+
+            ASSERT_EQ(t.overlapping(a, b), linear_overlapping(model, a, b));
+            ASSERT_EQ(t.stab(a), linear_overlapping(model, a, a));
+        }
+    }
+
+    ASSERT_EQ(t.size(), (int) model.size());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,203 @@
+#include <avl_tree_augment.hpp>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <string>
+
+typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+    avl_strict_balance, avl_sum<int> > sum_tree;
+
+/**
+ * @brief Amostra de uma série temporal, ordenada pelo instante
+ */
+struct sample {
+    long time;
+    double value;
+};
+
+struct by_time {
+    bool operator()(const sample& a, const sample& b) const { return a.time < b.time; }
+};
+
+struct same_time {
+    bool operator()(const sample& a, const sample& b) const { return a.time == b.time; }
+};
+
+struct sample_value {
+    double operator()(const sample& s) const { return s.value; }
+};
+
+struct is_even {
+    bool operator()(int x) const { return x % 2 == 0; }
+};
+
+TEST(Aggregate, Empty) {
+    sum_tree t;
+
+    EXPECT_EQ(t.aggregate(), 0);
+    ASSERT_EQ(t.aggregate(0, 100), 0);
+}
+
+TEST(Aggregate, Sum) {
+    sum_tree t;
+    for (int i = 1; i <= 100; i++)
+        t.insert(i);
+
+    EXPECT_EQ(t.aggregate(), 5050);
+    EXPECT_EQ(t.aggregate(1, 10), 55);
+    EXPECT_EQ(t.aggregate(-5, 0), 0);
+    EXPECT_EQ(t.aggregate(50, 50), 50);
+    EXPECT_EQ(t.aggregate(99, 1000), 199);
+    ASSERT_EQ(t.aggregate(1000, 2000), 0);
+}
+
+TEST(Aggregate, Random) {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_weak_balance, avl_sum<int> > tree;
+
+    std::mt19937 rng(17);
+    std::set<int> model;
+    tree t;
+
+    for (int i = 0; i < 3000; i++) {
+        int key = (int) (rng() % 1000);
+
+        switch (rng() % 4) {
+        case 0:
+        case 1:
+            model.insert(key);
+            t.update(key);
+            break;
+
+        case 2:
+            if (model.erase(key))
+                t.remove(key);
+            break;
+
+        case 3:
+            if (model.erase(key))
+                t.lazy_remove(key);
+            break;
+        }
+
+        int lo = (int) (rng() % 1000), hi = lo + (int) (rng() % 200);
+        int expected = 0;
+
+        for (auto it = model.lower_bound(lo); it != model.end() && *it <= hi; ++it)
+            expected += *it;
+
+        ASSERT_EQ(t.aggregate(lo, hi), expected);
+    }
+
+    int total = 0;
+    for (int x : model)
+        total += x;
+
+    ASSERT_EQ(t.aggregate(), total);
+}
+
+TEST(Aggregate, MaxOverTime) {
+    avl_tree<sample, by_time, same_time, avl_no_stats, avl_strict_balance,
+        avl_max<sample, sample_value> > t;
+
+    for (long i = 0; i < 1000; i++) {
+        sample s = { i, (double) ((i * 37) % 101) };
+        t.insert(s);
+    }
+
+    sample lo = { 0, 0 }, hi = { 50, 0 };
+    double expected = 0;
+
+    for (long i = 0; i <= 50; i++)
+        expected = std::max(expected, (double) ((i * 37) % 101));
+
+    EXPECT_EQ(t.aggregate(lo, hi), expected);
+    ASSERT_EQ(t.aggregate(), 100);
+}
+
+TEST(Aggregate, MinAndCountAfterBuild) {
+    std::vector<int> v;
+    for (int i = 10; i < 1010; i++)
+        v.push_back(i);
+
+    avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_strict_balance, avl_min<int> > m;
+    m.build(v.begin(), v.end());
+
+    avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_strict_balance, avl_count_if<int, is_even> > c;
+    c.build(v.begin(), v.end());
+
+    EXPECT_EQ(m.aggregate(), 10);
+    EXPECT_EQ(m.aggregate(500, 2000), 500);
+    EXPECT_EQ(c.aggregate(), 500);
+    ASSERT_EQ(c.aggregate(11, 20), 5);
+}
+
+TEST(Bounds, MinMax) {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_strict_balance, avl_bounds<int> > tree;
+
+    std::mt19937 rng(23);
+    std::set<int> model;
+    tree t;
+
+    for (int i = 0; i < 3000; i++) {
+        int key = (int) (rng() % 1000);
+
+        switch (rng() % 5) {
+        case 0:
+        case 1:
+            model.insert(key);
+            t.update(key);
+            break;
+
+        case 2:
+            if (model.erase(key))
+                t.lazy_remove(key);
+            break;
+
+        case 3:
+            if (!model.empty()) {
+                EXPECT_EQ(t.pop_min().value(), *model.begin());
+                model.erase(model.begin());
+            }
+            break;
+
+        case 4:
+            if (!model.empty()) {
+                EXPECT_EQ(t.pop_max().value(), *model.rbegin());
+                model.erase(std::prev(model.end()));
+            }
+            break;
+        }
+
+        if (!model.empty()) {
+            ASSERT_EQ(t.min(), *model.begin());
+            ASSERT_EQ(t.max(), *model.rbegin());
+        }
+    }
+}
+
+TEST(Bounds, Range) {
+    avl_tree<std::string, std::less<std::string>, std::equal_to<std::string>,
+        avl_no_stats, avl_strict_balance, avl_bounds<std::string> > t;
+
+    for (int i = 0; i < 100; i++)
+        t.insert(std::to_string(1000 + i * 2));
+
+    // Os agregados de um intervalo dão a primeira e a última informação nele
+    avl_bounds<std::string>::value_type r = t.aggregate("1011", "1050");
+
+    EXPECT_TRUE(r.present);
+    EXPECT_EQ(r.first, "1012");
+    EXPECT_EQ(r.last, "1050");
+    ASSERT_FALSE(t.aggregate("0", "0999").present);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    
+    return RUN_ALL_TESTS();
+}
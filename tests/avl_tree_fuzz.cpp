@@ -0,0 +1,453 @@
+/**
+ * @brief Fuzzer diferencial da árvore AVL
+ *
+ * Cada entrada é lida como uma sequência de operações, aplicadas em duas
+ * árvores e em dois `std::set` de referência. Depois de cada operação, as
+ * duas árvores são validadas com `validate()` e comparadas com os modelos;
+ * qualquer diferença aborta o programa.
+ *
+ * Com o libFuzzer, compile com:
+ *
+ *     clang++ -std=c++11 -g -fsanitize=fuzzer,address,undefined \
+ *         -DAVL_TREE_LIBFUZZER -Iinclude tests/avl_tree_fuzz.cpp
+ *
+ * Sem ele, `make fuzz` gera `build/fuzz`, que sorteia as entradas ou lê
+ * entradas salvas em arquivos.
+ *
+ * @file avl_tree_fuzz.cpp
+ */
+
+#ifndef AVL_TREE_VALIDATE
+#define AVL_TREE_VALIDATE
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <avl_tree.hpp>
+#include <avl_tree_augment.hpp>
+#include <avl_tree_prefix.hpp>
+
+using namespace std;
+
+typedef avl_tree<int, less<int>, equal_to<int>, avl_no_stats,
+    avl_strict_balance, avl_sum<int> > summed_tree;
+
+typedef avl_tree<int, less<int>, equal_to<int>, avl_no_stats,
+    avl_relaxed_balance<2> > relaxed_tree;
+
+typedef avl_tree<int, less<int>, equal_to<int>, avl_no_stats,
+    avl_weak_balance> weak_tree;
+
+typedef avl_tree<string, avl_prefix_less<> > prefixed_tree;
+
+typedef avl_tree<int, less<int>, equal_to<int>, avl_no_stats,
+    avl_relaxed_balance<2>, avl_bounds<int> > bounded_tree;
+
+typedef avl_tree<string, less<string>, equal_to<string>, avl_no_stats,
+    avl_weak_balance, avl_bounds<string> > bounded_text_tree;
+
+static const uint8_t* current_data = nullptr;  //! Entrada em execução
+static size_t current_size = 0;                 //! Tamanho da entrada
+
+/**
+ * @brief Salva a entrada atual, para ser repetida, e aborta
+ *
+ * @param what Descrição da falha
+ */
+static void fail(const char* what) {
+    cerr << "Fuzz failure: " << what << endl;
+
+    ofstream out("fuzz-crash.bin", ios::binary);
+    out.write((const char*) current_data, current_size);
+    cerr << "Input saved to fuzz-crash.bin" << endl;
+
+    abort();
+}
+
+/**
+ * @brief Leitor dos bytes de uma entrada, que dá zeros depois do fim
+ */
+class byte_reader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+
+public:
+    byte_reader(const uint8_t* data, size_t size) : data(data), size(size), pos(0) {}
+
+    bool done() const {
+        return pos >= size;
+    }
+
+    int next() {
+        return pos < size ? data[pos++] : 0;
+    }
+};
+
+/**
+ * @brief Leva um byte a uma chave do tipo da árvore
+ */
+static int make_key(int k, int) {
+    return k;
+}
+
+/**
+ * @brief Chaves de texto com prefixos repetidos, zeros e chaves que são
+ *        prefixo de outras
+ */
+static string make_key(int k, const string&) {
+    static const char* const heads[] = { "", "a", "abcdefgh", "abcdefgh\0z", "\xff\xff" };
+
+    string key(heads[k % 5], k % 5 == 3 ? 10 : strlen(heads[k % 5]));
+    key += string(k / 5 % 4, 'x');
+    key += (char) k;
+
+    return key;
+}
+
+/**
+ * @brief Confere o agregado de soma contra o modelo; as outras árvores
+ *        não têm agregado
+ */
+template <class Tree, class Key> static void check_aggregate(const Tree&, const set<Key>&, int, int) {}
+
+static void check_aggregate(const summed_tree& t, const set<int>& model, int lo, int hi) {
+    int total = 0, range = 0;
+
+    for (int x : model) {
+        total += x;
+
+        if (lo <= x && x <= hi)
+            range += x;
+    }
+
+    if (t.aggregate() != total || t.aggregate(lo, hi) != range)
+        fail("aggregate differs from the model");
+}
+
+/**
+ * @brief Valida uma árvore e compara com o seu modelo
+ */
+template <class Tree, class Key> static void check(const Tree& t, const set<Key>& model) {
+    try {
+        t.validate();
+    } catch (const char* e) {
+        fail(e);
+    }
+
+    if (t.size() != (int) model.size())
+        fail("size differs from the model");
+
+    if (!equal(model.begin(), model.end(), t.begin_in_order()))
+        fail("contents differ from the model");
+
+    if (!model.empty() && (t.min() != *model.begin() || t.max() != *model.rbegin()))
+        fail("min or max differs from the model");
+}
+
+/**
+ * @brief Executa uma operação que deve lançar uma exceção
+ */
+template <class Function> static void expect_throw(Function fn, const char* what) {
+    try {
+        fn();
+    } catch (const char*) {
+        return;
+    }
+
+    fail(what);
+}
+
+/**
+ * @brief Aplica as operações de uma entrada em duas árvores de um tipo
+ *
+ * Cada operação lê um byte de código, cujo bit mais alto escolhe a
+ * árvore, um byte de chave e um byte com a largura dos intervalos.
+ */
+template <class Tree, class Key> static void run(byte_reader& in) {
+    Tree trees[2];
+    set<Key> models[2];
+    typename Tree::reclaimer garbage;
+
+    while (!in.done()) {
+        int code = in.next();
+        int k = in.next();
+        int which = code >> 7;
+
+        Tree& t = trees[which];
+        Tree& other = trees[!which];
+        set<Key>& model = models[which];
+        set<Key>& other_model = models[!which];
+
+        Key key = make_key(k, Key());
+        Key hi = make_key(k + in.next() % 32, Key());
+
+        if (hi < key)
+            swap(key, hi);
+
+        try {
+            // As inserções são mais comuns, para que as árvores cresçam
+            switch ((code & 0x7f) % 24) {
+            case 0: case 1: case 2: case 3: case 4: case 5:
+                if (model.insert(key).second)
+                    t.insert(key);
+                else
+                    expect_throw([&] { t.insert(key); }, "repeated insert did not throw");
+                break;
+
+            case 6:
+                model.insert(key);
+                t.update(key);
+                break;
+
+            case 7: case 8: case 9:
+                if (model.erase(key))
+                    t.remove(key);
+                else
+                    expect_throw([&] { t.remove(key); }, "missing remove did not throw");
+                break;
+
+            case 10:
+                if (model.erase(key))
+                    t.lazy_remove(key, k % 4 / 4.0);
+                else
+                    expect_throw([&] { t.lazy_remove(key); }, "missing lazy remove did not throw");
+                break;
+
+            case 11:
+                if (model.empty()) {
+                    expect_throw([&] { t.pop(); }, "pop from empty tree did not throw");
+                    expect_throw([&] { t.pop_min(); }, "pop_min from empty tree did not throw");
+                } else if (k % 4 == 0) {
+                    if (t.pop() != *model.rbegin())
+                        fail("pop returned the wrong information");
+                    model.erase(prev(model.end()));
+                } else if (k % 4 == 1) {
+                    if (t.popleft() != *model.begin())
+                        fail("popleft returned the wrong information");
+                    model.erase(model.begin());
+                } else if (k % 4 == 2) {
+                    if (t.pop_max().value() != *model.rbegin())
+                        fail("pop_max returned the wrong information");
+                    model.erase(prev(model.end()));
+                } else {
+                    // O nó vai para a outra árvore, como numa fila reagendada
+                    typename Tree::node_type node = t.pop_min();
+
+                    if (node.value() != *model.begin())
+                        fail("pop_min returned the wrong information");
+
+                    Key x = node.value();
+                    model.erase(model.begin());
+
+                    if (other_model.insert(x).second)
+                        other.insert(move(node));
+                }
+                break;
+
+            case 12:
+                if (k % 2)
+                    t.compact();
+                else
+                    t.compact(k % 8);
+                break;
+
+            case 13: {
+                auto first = model.lower_bound(key), last = model.upper_bound(hi);
+                int expected = (int) distance(first, last);
+
+                model.erase(first, last);
+
+                if (t.erase_range(key, hi) != expected)
+                    fail("erase_range removed the wrong count");
+                break;
+            }
+
+            case 14: {
+                auto first = model.lower_bound(key), last = model.upper_bound(hi);
+                set<Key> expected(first, last);
+                model.erase(first, last);
+
+                Tree part = t.extract_range(key, hi);
+                check(part, expected);
+                break;
+            }
+
+            case 15:
+                if (model.erase(key)) {
+                    typename Tree::node_type node = t.extract(key);
+
+                    if (other_model.insert(key).second)
+                        other.insert(move(node));
+                    else
+                        expect_throw([&] { other.insert(move(node)); }, "repeated node did not throw");
+                }
+                break;
+
+            case 16: case 17:
+                if (model.insert(key).second)
+                    t.insert_hint(k % 2 ? t.begin_in_order() : t.end_in_order(), key);
+                break;
+
+            case 18:
+                // Cópia na escrita: as duas árvores passam a dividir os nós
+                other = t;
+                other_model = model;
+                break;
+
+            case 19: {
+                // As informações que já existem nesta árvore ficam na outra
+                set<Key> kept;
+
+                for (const Key& x : other_model)
+                    if (!model.insert(x).second)
+                        kept.insert(x);
+
+                other_model.swap(kept);
+                t.merge(other);
+                break;
+            }
+
+            case 20:
+                t.build(model.begin(), model.end());
+                break;
+
+            case 21:
+                swap(t, other);
+                swap(model, other_model);
+                break;
+
+            case 22:
+                if (k % 8 == 0) {
+                    t.clear();
+                    model.clear();
+                } else if (k % 8 == 1) {
+                    // Os nós são liberados aos poucos, nas próximas operações
+                    t.clear(garbage);
+                    model.clear();
+                }
+                break;
+
+            default:
+                if (t.includes(key) != (model.count(key) > 0))
+                    fail("includes differs from the model");
+
+                if ((t.find_hint(k % 2 ? t.begin_in_order() : t.end_in_order(), key) == t.end_in_order())
+                    == (model.count(key) > 0))
+                    fail("find_hint differs from the model");
+
+                if (!model.empty() && (t.min() != *model.begin() || t.max() != *model.rbegin()))
+                    fail("min or max differs from the model");
+                break;
+            }
+
+        } catch (const char* e) {
+            fail(e);
+        }
+
+        garbage.reclaim(k % 16);
+
+        check(trees[0], models[0]);
+        check(trees[1], models[1]);
+        check_aggregate(t, model, k, k + 32);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    current_data = data;
+    current_size = size;
+
+    byte_reader in(data, size);
+
+    switch (in.next() % 6) {
+    case 0: run<summed_tree, int>(in); break;
+    case 1: run<relaxed_tree, int>(in); break;
+    case 2: run<weak_tree, int>(in); break;
+    case 3: run<prefixed_tree, string>(in); break;
+    case 4: run<bounded_tree, int>(in); break;
+    case 5: run<bounded_text_tree, string>(in); break;
+    }
+
+    return 0;
+}
+
+#ifndef AVL_TREE_LIBFUZZER
+
+/**
+ * @brief Sorteia entradas, ou repete as entradas salvas em arquivos
+ */
+int main(int argc, char** argv) {
+    long runs = 20000;
+    size_t max_len = 1024;
+    unsigned seed = 1;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "-n" && has_value)
+            runs = atol(argv[++i]);
+        else if (arg == "-l" && has_value)
+            max_len = atol(argv[++i]);
+        else if (arg == "-s" && has_value)
+            seed = atoi(argv[++i]);
+        else if (arg[0] != '-') {
+            files.push_back(arg);
+        } else {
+            cerr << "Usage: " << argv[0] << " [-n runs] [-l max_len] [-s seed] [input...]" << endl;
+            return 1;
+        }
+    }
+
+    if (!files.empty()) {
+        for (const string& file : files) {
+            ifstream f(file, ios::binary);
+
+            if (!f) {
+                cerr << "Err: Can't open `" << file << "'" << endl;
+                return 1;
+            }
+
+            vector<uint8_t> data((istreambuf_iterator<char>(f)), istreambuf_iterator<char>());
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+        }
+
+        cout << files.size() << " inputs OK" << endl;
+        return 0;
+    }
+
+    mt19937 rng(seed);
+    vector<uint8_t> data;
+
+    for (long r = 0; r < runs; r++) {
+        data.resize(rng() % (max_len + 1));
+
+        // Depois do byte que escolhe a árvore, as operações têm 3 bytes; as
+        // chaves próximas tornam as colisões mais comuns
+        int spread = 1 << (rng() % 8 + 1);
+
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = i % 3 == 2 ? (uint8_t) (rng() % spread) : (uint8_t) rng();
+
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+    }
+
+    cout << runs << " runs OK" << endl;
+    return 0;
+}
+
+#endif
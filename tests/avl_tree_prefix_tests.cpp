@@ -0,0 +1,97 @@
+#include <avl_tree_prefix.hpp>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+typedef avl_tree<std::string, avl_prefix_less<> > prefixed_tree;
+
+/**
+ * @brief Comparador com prefixo que conta as comparações de strings inteiras
+ */
+struct counting_prefix_less : avl_prefix_less<> {
+    static int calls;
+
+    bool operator()(const std::string& a, const std::string& b) const {
+        calls++;
+        return a < b;
+    }
+};
+
+int counting_prefix_less::calls = 0;
+
+TEST(Prefix, Order) {
+    EXPECT_LT(avl_prefix_less<>::prefix("abc"), avl_prefix_less<>::prefix("abd"));
+    EXPECT_LT(avl_prefix_less<>::prefix("ab"), avl_prefix_less<>::prefix("abc"));
+    EXPECT_LT(avl_prefix_less<>::prefix("z"), avl_prefix_less<>::prefix("\xe9"));
+    EXPECT_EQ(avl_prefix_less<>::prefix("12345678a"), avl_prefix_less<>::prefix("12345678b"));
+    ASSERT_EQ(avl_prefix_less<>::prefix(""), 0u);
+}
+
+TEST(Prefix, Random) {
+    std::mt19937 rng(5);
+    std::set<std::string> model;
+    prefixed_tree t;
+
+    // Alfabeto pequeno, com zeros e bytes acima de 127, para forçar
+    // prefixos iguais e chaves que são prefixo umas das outras
+    const std::string alphabet("ab\0\xff", 4);
+
+    for (int step = 0; step < 20000; step++) {
+        std::string key;
+        int length = (int) (rng() % 12);
+
+        for (int i = 0; i < length; i++)
+            key += alphabet[rng() % alphabet.size()];
+
+        if (model.count(key)) {
+            ASSERT_TRUE(t.includes(key));
+            t.remove(key);
+            model.erase(key);
+        } else {
+            ASSERT_FALSE(t.includes(key));
+            t.insert(key);
+            model.insert(key);
+        }
+    }
+
+    std::vector<std::string> v(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(v, std::vector<std::string>(model.begin(), model.end()));
+}
+
+TEST(Prefix, FindSkipsFullComparisons) {
+    avl_tree<std::string, counting_prefix_less> t;
+
+    for (int i = 0; i < 1000; i++)
+        t.insert(std::to_string(10000000 + i * 7919 % 1000) + "/index.html");
+
+    counting_prefix_less::calls = 0;
+
+    for (int i = 0; i < 1000; i++)
+        ASSERT_TRUE(t.includes(std::to_string(10000000 + i) + "/index.html"));
+
+    // Os prefixos são todos diferentes; só a igualdade lê as strings
+    ASSERT_EQ(counting_prefix_less::calls, 0);
+}
+
+TEST(Prefix, NodeHandleRekey) {
+    prefixed_tree t;
+
+    for (int i = 0; i < 100; i++)
+        t.insert(std::to_string(1000 + i));
+
+    prefixed_tree::node_type node = t.extract("1050");
+    node.value() = "0999";
+    t.insert(std::move(node));
+
+    EXPECT_TRUE(t.includes("0999"));
+    EXPECT_FALSE(t.includes("1050"));
+    ASSERT_EQ(t.min(), "0999");
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
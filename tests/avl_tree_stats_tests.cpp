@@ -0,0 +1,302 @@
+#include <avl_tree_stats.hpp>
+#include <gtest/gtest.h>
+
+#include <string>
+
+typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_counting_stats> counted_tree;
+
+TEST(Rotations, Single) {
+    counted_tree::reset_stats();
+
+    counted_tree t;
+    t.insert(1);
+    t.insert(2);
+    t.insert(3);
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    EXPECT_EQ(s.single_rotations, 1u);
+    ASSERT_EQ(s.double_rotations, 0u);
+}
+
+TEST(Rotations, Double) {
+    counted_tree::reset_stats();
+
+    counted_tree t;
+    t.insert(1);
+    t.insert(3);
+    t.insert(2);
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    EXPECT_EQ(s.single_rotations, 0u);
+    ASSERT_EQ(s.double_rotations, 1u);
+}
+
+TEST(Counters, ComparisonsAndVisits) {
+    counted_tree t;
+    for (int i = 1; i <= 7; i++)
+        t.insert(i);
+
+    counted_tree::reset_stats();
+    ASSERT_TRUE(t.includes(1));
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    // Uma comparação de três vias por nível
+    EXPECT_EQ(s.visits, 3u);
+    ASSERT_EQ(s.comparisons, 3u);
+}
+
+TEST(Counters, AllocationsBalance) {
+    counted_tree::reset_stats();
+
+    {
+        counted_tree t;
+        for (int i = 0; i < 100; i++)
+            t.insert(i);
+
+        for (int i = 0; i < 10; i++)
+            t.pop();
+
+        for (int i = 0; i < 10; i++)
+            t.popleft();
+
+        counted_tree u(t);
+        t.remove(50);
+    }
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    EXPECT_GT(s.allocations, 0u);
+    ASSERT_EQ(s.allocations, s.deallocations);
+}
+
+TEST(Counters, ReclaimInSlices) {
+    counted_tree t;
+    for (int i = 0; i < 1000; i++)
+        t.insert(i);
+
+    counted_tree::reset_stats();
+    counted_tree::reclaimer garbage;
+    t.clear(garbage);
+
+    // Nada é liberado na hora, e a árvore já pode ser usada
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(counted_tree::stats().deallocations, 0u);
+
+    t.insert(1);
+
+    int slices = 0;
+    unsigned long freed = 0;
+
+    while (garbage.reclaim(16)) {
+        unsigned long now = counted_tree::stats().deallocations;
+        EXPECT_LE(now - freed, 16u);
+
+        freed = now;
+        slices++;
+    }
+
+    // A raiz fica no objeto; os outros 999 nós são liberados
+    EXPECT_GT(slices, 1);
+    ASSERT_EQ(counted_tree::stats().deallocations, 999u);
+}
+
+TEST(Counters, InlineArithmeticInfo) {
+    typedef avl_tree<
+        std::string, std::less<std::string>, std::equal_to<std::string>, avl_counting_stats
+    > string_tree;
+
+    counted_tree::reset_stats();
+
+    {
+        counted_tree t;
+        for (int i = 0; i < 100; i++)
+            t.insert(i);
+
+        // Um bloco por nó, fora a raiz; os inteiros ficam nos nós
+        EXPECT_EQ(counted_tree::stats().allocations, 99u);
+    }
+
+    string_tree::reset_stats();
+
+    {
+        string_tree t;
+        for (int i = 0; i < 100; i++)
+            t.insert(std::to_string(1000 + i));
+
+        // Os outros tipos ainda são alocados à parte
+        EXPECT_EQ(string_tree::stats().allocations, 199u);
+
+        for (int i = 0; i < 50; i++)
+            t.remove(std::to_string(1000 + 2 * i));
+
+        EXPECT_EQ(t.min(), "1001");
+    }
+
+    avl_stats_snapshot s = string_tree::stats();
+    ASSERT_EQ(s.allocations, s.deallocations);
+}
+
+TEST(Counters, NodeHandlesDoNotAllocate) {
+    counted_tree a, b;
+    for (int i = 0; i < 100; i++)
+        a.insert(i);
+
+    b.insert(-1);
+
+    counted_tree::reset_stats();
+
+    for (int i = 0; i < 100; i += 2)
+        b.insert(a.extract(i));
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    EXPECT_EQ(s.allocations, 0u);
+    ASSERT_EQ(s.deallocations, 0u);
+}
+
+TEST(Counters, CopySharesNodes) {
+    counted_tree::reset_stats();
+
+    {
+        counted_tree t;
+        for (int i = 0; i < 1000; i++)
+            t.insert(i);
+
+        avl_stats_snapshot before = counted_tree::stats();
+        counted_tree u(t);
+
+        // A cópia não aloca; a raiz guarda o número no próprio objeto
+        EXPECT_EQ(counted_tree::stats().allocations, before.allocations);
+
+        // Uma alteração copia só o caminho da raiz até o nó
+        u.insert(1000);
+        EXPECT_LE(counted_tree::stats().allocations - before.allocations, (unsigned) t.height() + 1);
+
+        EXPECT_EQ(t.size(), 1000);
+        EXPECT_FALSE(t.includes(1000));
+        EXPECT_EQ(u.size(), 1001);
+    }
+
+    avl_stats_snapshot s = counted_tree::stats();
+    ASSERT_EQ(s.allocations, s.deallocations);
+}
+
+TEST(Latency, PerOperation) {
+    counted_tree::reset_stats();
+
+    counted_tree t;
+    for (int i = 0; i < 100; i++)
+        t.insert(i);
+
+    for (int i = 0; i < 10; i++)
+        t.remove(i);
+
+    t.includes(50);
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    EXPECT_EQ(s.latency[AVL_INSERT].count, 100u);
+    EXPECT_EQ(s.latency[AVL_REMOVE].count, 10u);
+    EXPECT_EQ(s.latency[AVL_FIND].count, 1u);
+    EXPECT_GE(s.latency[AVL_INSERT].percentile(99), s.latency[AVL_INSERT].percentile(50));
+
+    unsigned long retraced = 0;
+    for (int i = 0; i < avl_stats_snapshot::RETRACE_BUCKETS; i++)
+        retraced += s.retrace_depth[i];
+
+    EXPECT_EQ(retraced, 110u);
+    ASSERT_GT(s.max_retrace, 0);
+}
+
+template <class Balance> static unsigned long rotations_for_churn() {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_counting_stats, Balance> tree;
+
+    tree::reset_stats();
+
+    tree t;
+    for (int i = 0; i < 1000; i++)
+        t.insert((i * 7919) % 1000);
+
+    for (int i = 0; i < 1000; i += 2)
+        t.remove((i * 7919) % 1000);
+
+    avl_stats_snapshot s = tree::stats();
+    return s.single_rotations + s.double_rotations;
+}
+
+TEST(Rotations, RelaxedDoesLessWork) {
+    unsigned long strict = rotations_for_churn<avl_strict_balance>();
+    unsigned long relaxed = rotations_for_churn<avl_relaxed_balance<2> >();
+
+    EXPECT_GT(strict, 0u);
+    ASSERT_LT(relaxed, strict);
+}
+
+TEST(Rotations, WeakOnlyInserts) {
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_counting_stats> strict_tree;
+    typedef avl_tree<int, std::less<int>, std::equal_to<int>, avl_counting_stats, avl_weak_balance> weak_tree;
+
+    strict_tree s;
+    weak_tree w;
+
+    for (int i = 0; i < 1000; i++) {
+        s.insert((i * 7919) % 1000);
+        w.insert((i * 7919) % 1000);
+    }
+
+    // Sem remoções, a WAVL é uma árvore AVL
+    ASSERT_EQ(w.height(), s.height());
+}
+
+TEST(Counters, HintedAppendComparisons) {
+    counted_tree t;
+    auto it = t.end_in_order();
+
+    counted_tree::reset_stats();
+
+    for (int i = 0; i < 10000; i++)
+        it = t.insert_hint(it, i);
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    // Uma comparação de igualdade e uma de ordem com o nó anterior, mais
+    // as descidas depois das rotações
+    EXPECT_LT(s.comparisons, 10000u * 6);
+    ASSERT_EQ(s.latency[AVL_INSERT].count, 10000u);
+}
+
+TEST(Counters, HintedScanComparisons) {
+    counted_tree t;
+    for (int i = 0; i < 10000; i++)
+        t.insert(i);
+
+    counted_tree::reset_stats();
+
+    for (int i = 0; i < 10000; i++)
+        t.includes(i);
+
+    avl_stats_snapshot root = counted_tree::stats();
+
+    auto it = t.begin_in_order();
+    counted_tree::reset_stats();
+
+    for (int i = 0; i < 10000; i++)
+        it = t.find_hint(it, i);
+
+    avl_stats_snapshot s = counted_tree::stats();
+
+    // Cada busca sobe em média poucos níveis a partir da anterior, em vez
+    // de descer toda a altura desde a raiz
+    EXPECT_LT(s.comparisons, 10000u * 6);
+    EXPECT_LT(s.comparisons * 2, root.comparisons);
+    ASSERT_EQ(s.latency[AVL_FIND].count, 10000u);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,13 @@
 #include <avl_tree.hpp>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
 TEST(Insert, Leaf) {
     avl_tree<int> t;
     t.insert(0);
@@ -249,6 +256,58 @@ TEST(Pop, MultiLevel) {
     ASSERT_FALSE(t.includes(8));
 }
 
+TEST(PopMin, Empty) {
+    avl_tree<int> t;
+
+    EXPECT_THROW(t.pop_min(), const char*);
+    ASSERT_THROW(t.pop_max(), const char*);
+}
+
+TEST(PopMin, Order) {
+    avl_tree<int> t;
+    for (int i = 0; i < 100; i++)
+        t.insert(i * 37 % 100);
+
+    for (int i = 0; i < 50; i++) {
+        ASSERT_EQ(t.pop_min().value(), i);
+        ASSERT_EQ(t.pop_max().value(), 99 - i);
+    }
+
+    ASSERT_TRUE(t.empty());
+}
+
+TEST(PopMin, SkipsTombstones) {
+    avl_tree<int> t;
+    for (int i = 0; i < 10; i++)
+        t.insert(i);
+
+    t.lazy_remove(0);
+    t.lazy_remove(1);
+    t.lazy_remove(9);
+
+    EXPECT_EQ(t.pop_min().value(), 2);
+    EXPECT_EQ(t.pop_max().value(), 8);
+    EXPECT_EQ(t.size(), 5);
+    ASSERT_EQ(t.min(), 3);
+}
+
+TEST(PopMin, Requeue) {
+    avl_tree<std::string> t;
+    for (int i = 0; i < 100; i++)
+        t.insert(std::to_string(1000 + i));
+
+    // Como numa fila de prazos: o primeiro volta para o fim
+    for (int i = 0; i < 100; i++) {
+        avl_tree<std::string>::node_type node = t.pop_min();
+        node.value() = std::to_string(2000 + i);
+        t.insert(std::move(node));
+    }
+
+    EXPECT_EQ(t.size(), 100);
+    EXPECT_EQ(t.min(), "2000");
+    ASSERT_EQ(t.max(), "2099");
+}
+
 TEST(Remove, Empty) {
     avl_tree<double> t;
     
@@ -274,6 +333,1273 @@ TEST(Remove, DoesNotHaveInfo_Leaf) {
     ASSERT_THROW(t.remove(10.0), const char*);
 }
 
+TEST(Build, Sorted) {
+    std::vector<int> v;
+    for (int i = 1; i <= 1000; i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build(v.begin(), v.end());
+
+    EXPECT_EQ(t.size(), 1000);
+    EXPECT_EQ(t.height(), 10);
+
+    for (int i = 1; i <= 1000; i++)
+        ASSERT_TRUE(t.includes(i));
+}
+
+TEST(Build, Unsorted) {
+    int v[] = { 1, 3, 2 };
+
+    avl_tree<int> t;
+    t.insert(7);
+
+    ASSERT_THROW(t.build(v, v + 3), const char*);
+    ASSERT_TRUE(t.includes(7));
+}
+
+TEST(Parallel, Build) {
+    std::vector<int> v;
+    for (int i = 0; i < 100000; i++)
+        v.push_back(2 * i);
+
+    avl_tree<int> serial, parallel;
+    serial.build(v.begin(), v.end());
+    parallel.build_parallel(v.begin(), v.end(), 4);
+
+    EXPECT_EQ(parallel.size(), serial.size());
+    EXPECT_EQ(parallel.height(), serial.height());
+
+    std::stringstream a, b;
+    a << serial;
+    b << parallel;
+    ASSERT_EQ(a.str(), b.str());
+}
+
+TEST(Parallel, BuildUnsorted) {
+    std::vector<int> v;
+    for (int i = 0; i < 100000; i++)
+        v.push_back(i);
+
+    std::swap(v[20000], v[20001]);
+
+    avl_tree<int> t;
+    t.insert(-1);
+
+    ASSERT_THROW(t.build_parallel(v.begin(), v.end(), 4), const char*);
+    ASSERT_EQ(t.size(), 1);
+    ASSERT_TRUE(t.includes(-1));
+}
+
+TEST(Parallel, ForEach) {
+    std::vector<int> v;
+    for (int i = 0; i < 100000; i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build_parallel(v.begin(), v.end(), 4);
+
+    // Algumas lápides no meio
+    for (int i = 0; i < 100000; i += 7)
+        t.lazy_remove(i, 1.0);
+
+    std::atomic<long> sum(0), count(0);
+
+    t.parallel_for_each([&](int x) {
+        sum += x;
+        count++;
+    }, 4);
+
+    long expected = 0, n = 0;
+    for (int i = 0; i < 100000; i++)
+        if (i % 7 != 0) {
+            expected += i;
+            n++;
+        }
+
+    EXPECT_EQ(count.load(), n);
+    ASSERT_EQ(sum.load(), expected);
+}
+
+TEST(Parallel, Reduce) {
+    std::vector<int> v;
+    for (int i = 0; i < 60000; i++)
+        v.push_back(i);
+
+    avl_tree<int> t;
+    t.build_parallel(v.begin(), v.end(), 4);
+
+    long sum = t.parallel_reduce(0l,
+        [](int x) { return (long) x; },
+        [](long a, long b) { return a + b; }, 4);
+
+    EXPECT_EQ(sum, 60000l * 59999 / 2);
+
+    // A combinação respeita a ordem: o resultado é o primeiro e o último
+    typedef std::pair<int, int> ends;
+
+    ends e = t.parallel_reduce(ends(-1, -1),
+        [](int x) { return ends(x, x); },
+        [](ends a, ends b) {
+            if (a.first < 0) return b;
+            if (b.first < 0) return a;
+            return ends(a.first, b.second);
+        }, 4);
+
+    EXPECT_EQ(e.first, 0);
+    ASSERT_EQ(e.second, 59999);
+
+    avl_tree<int> empty;
+    ASSERT_EQ(empty.parallel_reduce(0, [](int x) { return x; }, [](int a, int b) { return a + b; }), 0);
+}
+
+TEST(LoadText, RoundTrip) {
+    avl_tree<int> t;
+    for (int i = 0; i < 100; i++)
+        t.insert((i * 37) % 100 - 50);
+
+    std::stringstream s;
+    s << t;
+
+    avl_tree<int> u;
+    s >> u;
+
+    EXPECT_EQ(u.size(), 100);
+
+    for (int i = -50; i < 50; i++)
+        ASSERT_TRUE(u.includes(i));
+}
+
+TEST(LoadText, Empty) {
+    std::stringstream s("( )");
+
+    avl_tree<int> t;
+    t.insert(1);
+    s >> t;
+
+    ASSERT_TRUE(t.empty());
+}
+
+TEST(LoadText, Malformed) {
+    std::stringstream s("( ( 1 ) 2 ( 3 )");
+
+    avl_tree<int> t;
+    ASSERT_THROW(s >> t, const char*);
+}
+
+TEST(LoadText, NegativeUnsigned) {
+    std::stringstream s("( -5 )");
+
+    avl_tree<unsigned> t;
+    ASSERT_THROW(s >> t, const char*);
+    ASSERT_TRUE(t.empty());
+}
+
+TEST(Graphviz, Annotated) {
+    avl_tree<int> t;
+    t.insert(2);
+    t.insert(1);
+    t.insert(3);
+
+    avl_tree<int>::gv_options opts;
+    opts.show_height = true;
+
+    std::ostringstream out;
+    t.gv_save(out, opts);
+
+    EXPECT_NE(out.str().find("\"n0\" [label=\"2\\nh=2\"]"), std::string::npos);
+    EXPECT_NE(out.str().find("\"n0\" -- \"n1\""), std::string::npos);
+    ASSERT_NE(out.str().find("\"n0\" -- \"n2\""), std::string::npos);
+}
+
+TEST(Graphviz, DepthLimitedFocus) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 15; i++)
+        t.insert(i);
+
+    avl_tree<int>::gv_options opts;
+    opts.max_depth = 0;
+
+    std::ostringstream out;
+    t.gv_save(out, 4, opts);
+
+    EXPECT_NE(out.str().find("[label=\"4\"]"), std::string::npos);
+    EXPECT_NE(out.str().find("[label=\"+3\", shape=plaintext]"), std::string::npos);
+    ASSERT_THROW(t.gv_save(out, 16), const char*);
+}
+
+TEST(Text, Nested) {
+    avl_tree<int> t;
+    t.insert(2);
+    t.insert(1);
+    t.insert(3);
+    t.insert(-4);
+
+    std::ostringstream out;
+    out << t;
+
+    ASSERT_EQ(out.str(), "( ( ( -4 ) 1 ) 2 ( 3 ) )");
+}
+
+TEST(Text, FloatFormat) {
+    avl_tree<double> t;
+    t.insert(1.0 / 3);
+    t.insert(2.5);
+
+    std::ostringstream plain, fixed;
+    plain << t;
+
+    fixed.precision(3);
+    fixed << std::fixed << t;
+
+    EXPECT_EQ(plain.str(), "( 0.333333 ( 2.5 ) )");
+    ASSERT_EQ(fixed.str(), "( 0.333 ( 2.500 ) )");
+}
+
+TEST(Dump, Orders) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 7; i++)
+        t.insert(i);
+
+    std::ostringstream in, pre, post, level;
+    t.dump(in);
+    t.dump(pre, avl_tree<int>::pre_order);
+    t.dump(post, avl_tree<int>::post_order);
+    t.dump(level, avl_tree<int>::level_order);
+
+    EXPECT_EQ(in.str(), "1 2 3 4 5 6 7 \n");
+    EXPECT_EQ(pre.str(), "4 2 1 3 6 5 7 \n");
+    EXPECT_EQ(post.str(), "1 3 2 5 7 6 4 \n");
+    ASSERT_EQ(level.str(), "4 \n2 6 \n1 3 5 7 \n");
+}
+
+TEST(LevelIterator, Order) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 7; i++)
+        t.insert(i);
+
+    int expected[] = { 4, 2, 6, 1, 3, 5, 7 };
+    int levels[] = { 0, 1, 1, 2, 2, 2, 2 };
+    int i = 0;
+
+    for (auto it = t.begin_by_level(); it != t.end_by_level(); ++it, i++) {
+        EXPECT_EQ(*it, expected[i]);
+        EXPECT_EQ(it.level(), levels[i]);
+    }
+
+    ASSERT_EQ(i, 7);
+}
+
+TEST(LevelIterator, PostIncrement) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 3; i++)
+        t.insert(i);
+
+    auto it = t.begin_by_level();
+    auto old = it++;
+
+    EXPECT_EQ(*old, 2);
+    ASSERT_EQ(*it, 1);
+}
+
+TEST(ForEachLevel, Order) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 100; i++)
+        t.insert(i);
+
+    std::vector<int> by_iterator, by_callback;
+    int last_level = 0;
+
+    for (auto it = t.begin_by_level(); it != t.end_by_level(); ++it)
+        by_iterator.push_back(*it);
+
+    t.for_each_level([&](int data, int level) {
+        EXPECT_GE(level, last_level);
+        last_level = level;
+        by_callback.push_back(data);
+    });
+
+    EXPECT_EQ(last_level, t.height() - 1);
+    ASSERT_EQ(by_iterator, by_callback);
+}
+
+/**
+ * @brief Verifica a ordem, os tamanhos e o balanceamento de uma subárvore
+ *
+ * @param t Subárvore
+ * @param slack Maior diferença de altura aceita, ou 0 para verificar os
+ *        postos da WAVL
+ * @return int A altura real da subárvore
+ */
+template <class Tree> static int check_node(Tree* t, int slack) {
+    if (!t)
+        return 0;
+
+    Tree* l = t->get_left();
+    Tree* r = t->get_right();
+
+    if (l) {
+        EXPECT_LT(l->max(), t->get_info());
+    }
+
+    if (r) {
+        EXPECT_GT(r->min(), t->get_info());
+    }
+
+    int lh = check_node(l, slack), rh = check_node(r, slack);
+    int height = (lh > rh ? lh : rh) + 1;
+
+    EXPECT_EQ(t->size(), 1 + (l ? l->size() : 0) + (r ? r->size() : 0));
+
+    if (slack > 0) {
+        EXPECT_EQ(t->height(), height);
+        EXPECT_LE(rh - lh, slack);
+        EXPECT_GE(rh - lh, -slack);
+
+    } else {
+        int ld = t->height() - (l ? l->height() : 0),
+            rd = t->height() - (r ? r->height() : 0);
+
+        EXPECT_TRUE(ld == 1 || ld == 2);
+        EXPECT_TRUE(rd == 1 || rd == 2);
+        EXPECT_GE(t->height(), height);
+
+        if (!l && !r) {
+            EXPECT_EQ(t->height(), 1);
+        }
+    }
+
+    return height;
+}
+
+/**
+ * @brief Aplica operações aleatórias numa árvore e num std::set, e compara
+ */
+template <class Tree> static void random_operations(int slack) {
+    std::mt19937 rng(1234);
+    std::set<int> model;
+    Tree t;
+
+    for (int i = 0; i < 4000; i++) {
+        int key = (int) (rng() % 500);
+
+        switch (rng() % 6) {
+        case 0:
+        case 1:
+            if (model.insert(key).second) {
+                t.insert(key);
+            } else {
+                ASSERT_THROW(t.insert(key), const char*);
+            }
+            break;
+
+        case 2:
+            model.insert(key);
+            t.update(key);
+            break;
+
+        case 3:
+            if (model.erase(key))
+                t.remove(key);
+            break;
+
+        case 4:
+            if (!model.empty()) {
+                ASSERT_EQ(t.pop(), *model.rbegin());
+                model.erase(std::prev(model.end()));
+            }
+            break;
+
+        case 5:
+            if (!model.empty()) {
+                ASSERT_EQ(t.popleft(), *model.begin());
+                model.erase(model.begin());
+            }
+            break;
+        }
+
+        ASSERT_EQ(t.size(), (int) model.size());
+
+        if (i % 100 == 0 && !t.empty())
+            check_node(&t, slack);
+    }
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(items, std::vector<int>(model.begin(), model.end()));
+}
+
+TEST(Balance, Strict) {
+    random_operations<avl_tree<int> >(1);
+}
+
+TEST(Balance, Relaxed) {
+    random_operations<avl_tree<int, std::less<int>, std::equal_to<int>,
+        avl_no_stats, avl_relaxed_balance<3> > >(3);
+}
+
+TEST(Balance, Weak) {
+    random_operations<avl_tree<int, std::less<int>, std::equal_to<int>,
+        avl_no_stats, avl_weak_balance> >(0);
+}
+
+TEST(LazyRemove, SkipsTombstones) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 10; i++)
+        t.insert(i);
+
+    int height = t.height();
+
+    t.lazy_remove(1, 1.0);
+    t.lazy_remove(5, 1.0);
+    t.lazy_remove(10, 1.0);
+
+    EXPECT_EQ(t.size(), 7);
+    EXPECT_EQ(t.tombstones(), 3);
+    EXPECT_EQ(t.height(), height);
+    EXPECT_FALSE(t.includes(5));
+    EXPECT_EQ(t.min(), 2);
+    EXPECT_EQ(t.max(), 9);
+    EXPECT_THROW(t.lazy_remove(5), const char*);
+    EXPECT_THROW(t.remove(5), const char*);
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    EXPECT_EQ(items, std::vector<int>({ 2, 3, 4, 6, 7, 8, 9 }));
+
+    std::ostringstream out;
+    t.dump(out);
+    ASSERT_EQ(out.str(), "2 3 4 6 7 8 9 \n");
+}
+
+TEST(LazyRemove, Revive) {
+    avl_tree<int> t;
+    for (int i = 1; i <= 7; i++)
+        t.insert(i);
+
+    t.lazy_remove(4, 1.0);
+    t.insert(4);
+
+    EXPECT_EQ(t.size(), 7);
+    EXPECT_EQ(t.tombstones(), 0);
+    ASSERT_TRUE(t.includes(4));
+}
+
+TEST(LazyRemove, Compact) {
+    avl_tree<int> t;
+    for (int i = 0; i < 100; i++)
+        t.insert(i);
+
+    for (int i = 0; i < 100; i += 3)
+        t.lazy_remove(i, 1.0);
+
+    EXPECT_EQ(t.compact(10), 24);
+    EXPECT_EQ(t.size(), 66);
+
+    t.compact();
+
+    EXPECT_EQ(t.tombstones(), 0);
+    EXPECT_EQ(t.size(), 66);
+    EXPECT_EQ(t.height(), 7);
+    check_node(&t, 1);
+
+    for (int i = 0; i < 100; i++)
+        ASSERT_EQ(t.includes(i), i % 3 != 0);
+}
+
+TEST(LazyRemove, Random) {
+    std::mt19937 rng(99);
+    std::set<int> model;
+    avl_tree<int> t;
+
+    for (int i = 0; i < 4000; i++) {
+        int key = (int) (rng() % 300);
+
+        switch (rng() % 4) {
+        case 0:
+        case 1:
+            model.insert(key);
+            t.update(key);
+            break;
+
+        case 2:
+            if (model.erase(key)) {
+                t.lazy_remove(key);
+            } else {
+                ASSERT_THROW(t.lazy_remove(key), const char*);
+            }
+            break;
+
+        case 3:
+            if (!model.empty()) {
+                ASSERT_EQ(t.popleft(), *model.begin());
+                model.erase(model.begin());
+            }
+            break;
+        }
+
+        ASSERT_EQ(t.size(), (int) model.size());
+        ASSERT_LE(t.tombstones(), t.size() / 3 + 2);
+    }
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(items, std::vector<int>(model.begin(), model.end()));
+
+    t.compact();
+    check_node(&t, 1);
+}
+
+TEST(InsertHint, Append) {
+    avl_tree<int> t;
+    auto it = t.end_in_order();
+
+    for (int i = 0; i < 1000; i++) {
+        it = t.insert_hint(it, i);
+        ASSERT_EQ(*it, i);
+    }
+
+    EXPECT_EQ(t.size(), 1000);
+    EXPECT_EQ(t.height(), 10);
+    check_node(&t, 1);
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    for (int i = 0; i < 1000; i++)
+        ASSERT_EQ(items[i], i);
+}
+
+TEST(InsertHint, Repeated) {
+    avl_tree<int> t;
+    for (int i = 0; i < 10; i++)
+        t.insert(2 * i);
+
+    auto it = t.begin_in_order();
+    for (int i = 0; i < 4; i++)
+        ++it;
+
+    EXPECT_THROW(t.insert_hint(it, 6), const char*);
+    EXPECT_THROW(t.insert_hint(it, 0), const char*);
+    EXPECT_THROW(t.insert_hint(it, 18), const char*);
+
+    avl_tree<int> other;
+    other.insert(1);
+    ASSERT_THROW(other.insert_hint(it, 3), const char*);
+}
+
+TEST(InsertHint, Random) {
+    std::mt19937 rng(5);
+    std::set<int> model;
+    avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats, avl_weak_balance> t;
+    auto it = t.end_in_order();
+
+    for (int i = 0; i < 3000; i++) {
+        int key = (int) (rng() % 2000);
+
+        if (rng() % 4 == 0 && model.count(key)) {
+            model.erase(key);
+            t.lazy_remove(key);
+            it = t.begin_in_order();
+            continue;
+        }
+
+        if (model.insert(key).second) {
+            it = t.insert_hint(it, key);
+            ASSERT_EQ(*it, key);
+        } else {
+            ASSERT_THROW(t.insert_hint(it, key), const char*);
+        }
+
+        ASSERT_EQ(t.size(), (int) model.size());
+    }
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(items, std::vector<int>(model.begin(), model.end()));
+
+    t.compact();
+    check_node(&t, 0);
+}
+
+TEST(FindHint, Ascending) {
+    avl_tree<int> t;
+    for (int i = 0; i < 1000; i++)
+        t.insert(2 * i);
+
+    auto it = t.begin_in_order();
+
+    for (int i = 0; i < 1000; i++) {
+        it = t.find_hint(it, 2 * i);
+        ASSERT_EQ(*it, 2 * i);
+    }
+
+    EXPECT_TRUE(t.find_hint(it, 7) == t.end_in_order());
+    EXPECT_TRUE(t.find_hint(t.end_in_order(), 2000) == t.end_in_order());
+    EXPECT_EQ(*t.find_hint(t.end_in_order(), 0), 0);
+
+    avl_tree<int> other;
+    other.insert(1);
+    ASSERT_THROW(other.find_hint(it, 1), const char*);
+}
+
+TEST(FindHint, Random) {
+    std::mt19937 rng(9);
+    std::set<int> model;
+    avl_tree<int> t;
+
+    for (int i = 0; i < 2000; i++) {
+        int key = (int) (rng() % 3000);
+
+        if (model.insert(key).second)
+            t.insert(key);
+    }
+
+    for (int i = 0; i < 3000; i += 3) {
+        if (model.erase(i))
+            t.lazy_remove(i);
+    }
+
+    auto it = t.begin_in_order();
+
+    for (int i = 0; i < 3000; i++) {
+        int key = (int) (rng() % 3000);
+        auto found = t.find_hint(it, key);
+
+        if (model.count(key)) {
+            ASSERT_EQ(*found, key);
+            it = found;
+        } else {
+            ASSERT_TRUE(found == t.end_in_order());
+        }
+    }
+}
+
+TEST(Range, Erase) {
+    avl_tree<int> t;
+    for (int i = 0; i < 1000; i++)
+        t.insert(i);
+
+    EXPECT_EQ(t.erase_range(100, 199), 100);
+    EXPECT_EQ(t.erase_range(150, 250), 51);
+    EXPECT_EQ(t.erase_range(2000, 3000), 0);
+    EXPECT_EQ(t.erase_range(10, 5), 0);
+    EXPECT_EQ(t.size(), 849);
+    check_node(&t, 1);
+
+    for (int i = 0; i < 1000; i++)
+        ASSERT_EQ(t.includes(i), i < 100 || i > 250);
+
+    EXPECT_EQ(t.erase_range(-10, 2000), 849);
+    ASSERT_TRUE(t.empty());
+}
+
+TEST(Range, Extract) {
+    avl_tree<int> t;
+    for (int i = 0; i < 1000; i++)
+        t.insert(i);
+
+    avl_tree<int> removed = t.extract_range(300, 699);
+
+    EXPECT_EQ(removed.size(), 400);
+    EXPECT_EQ(removed.min(), 300);
+    EXPECT_EQ(removed.max(), 699);
+    EXPECT_EQ(t.size(), 600);
+    check_node(&t, 1);
+    check_node(&removed, 1);
+
+    // A árvore extraída continua utilizável
+    removed.insert(1000);
+    ASSERT_EQ(removed.max(), 1000);
+}
+
+TEST(Range, ExtractWithTombstones) {
+    avl_tree<int> t;
+    for (int i = 0; i < 100; i++)
+        t.insert(i);
+
+    for (int i = 0; i < 100; i += 2)
+        t.lazy_remove(i, 1.0);
+
+    avl_tree<int> removed = t.extract_range(10, 19);
+
+    EXPECT_EQ(removed.size(), 5);
+    EXPECT_EQ(removed.min(), 11);
+    EXPECT_EQ(t.size(), 45);
+    ASSERT_EQ(t.tombstones() + removed.tombstones(), 50);
+}
+
+/**
+ * @brief Remove intervalos aleatórios de uma árvore e de um std::set, e
+ *        compara
+ */
+template <class Tree> static void random_ranges(int slack) {
+    std::mt19937 rng(77);
+    std::set<int> model;
+    Tree t;
+
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 50; i++) {
+            int x = (int) (rng() % 5000);
+
+            if (model.insert(x).second)
+                t.insert(x);
+        }
+
+        int lo = (int) (rng() % 5000), hi = lo + (int) (rng() % 200);
+        auto first = model.lower_bound(lo), last = model.upper_bound(hi);
+        std::vector<int> expected(first, last);
+
+        if (round % 2) {
+            ASSERT_EQ(t.erase_range(lo, hi), (int) expected.size());
+        } else {
+            Tree removed = t.extract_range(lo, hi);
+            std::vector<int> items(removed.begin_in_order(), removed.end_in_order());
+
+            ASSERT_EQ(items, expected);
+
+            if (!removed.empty())
+                check_node(&removed, slack);
+        }
+
+        model.erase(first, last);
+
+        ASSERT_EQ(t.size(), (int) model.size());
+
+        if (!t.empty())
+            check_node(&t, slack);
+    }
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(items, std::vector<int>(model.begin(), model.end()));
+}
+
+TEST(Range, RandomStrict) {
+    random_ranges<avl_tree<int> >(1);
+}
+
+TEST(Range, RandomRelaxed) {
+    random_ranges<avl_tree<int, std::less<int>, std::equal_to<int>,
+        avl_no_stats, avl_relaxed_balance<3> > >(3);
+}
+
+TEST(Range, RandomWeak) {
+    random_ranges<avl_tree<int, std::less<int>, std::equal_to<int>,
+        avl_no_stats, avl_weak_balance> >(0);
+}
+
+TEST(NodeHandle, ExtractInsert) {
+    avl_tree<int> a, b;
+    for (int i = 0; i < 100; i++)
+        a.insert(i);
+
+    for (int i = 0; i < 100; i += 3) {
+        avl_tree<int>::node_type node = a.extract(i);
+
+        ASSERT_FALSE(node.empty());
+        ASSERT_EQ(node.value(), i);
+
+        b.insert(std::move(node));
+        ASSERT_TRUE(node.empty());
+    }
+
+    EXPECT_EQ(a.size(), 66);
+    EXPECT_EQ(b.size(), 34);
+    check_node(&a, 1);
+    check_node(&b, 1);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(a.includes(i), i % 3 != 0);
+        ASSERT_EQ(b.includes(i), i % 3 == 0);
+    }
+
+    ASSERT_THROW(a.extract(0), const char*);
+}
+
+TEST(NodeHandle, Rekey) {
+    avl_tree<int> t;
+    t.insert(1);
+    t.insert(2);
+
+    avl_tree<int>::node_type node = t.extract(1);
+    node.value() = 10;
+    t.insert(std::move(node));
+
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(items, std::vector<int>({ 2, 10 }));
+
+    // O único elemento da árvore também pode ser desligado
+    avl_tree<int> one;
+    one.insert(5);
+
+    node = one.extract(5);
+    EXPECT_TRUE(one.empty());
+    EXPECT_EQ(one.size(), 0);
+
+    one.insert(std::move(node));
+    ASSERT_TRUE(one.includes(5));
+}
+
+TEST(NodeHandle, Repeated) {
+    avl_tree<int> a, b;
+    a.insert(1);
+    b.insert(1);
+    b.insert(2);
+
+    avl_tree<int>::node_type node = b.extract(1);
+
+    ASSERT_THROW(a.insert(std::move(node)), const char*);
+    ASSERT_FALSE(node.empty());
+
+    // Uma lápide é reaproveitada
+    a.lazy_remove(1, 1.0);
+    a.insert(std::move(node));
+
+    EXPECT_TRUE(node.empty());
+    EXPECT_EQ(a.tombstones(), 0);
+    ASSERT_TRUE(a.includes(1));
+}
+
+TEST(NodeHandle, Merge) {
+    avl_tree<int> a, b;
+    for (int i = 0; i < 100; i += 2)
+        a.insert(i);
+
+    for (int i = 0; i < 100; i += 3)
+        b.insert(i);
+
+    b.lazy_remove(99, 1.0);
+    a.merge(b);
+
+    check_node(&a, 1);
+    check_node(&b, 1);
+
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(a.includes(i), i % 2 == 0 || (i % 3 == 0 && i != 99));
+        ASSERT_EQ(b.includes(i), i % 6 == 0);
+    }
+
+    EXPECT_EQ(b.tombstones(), 0);
+
+    avl_tree<int> empty;
+    a.merge(empty);
+    empty.merge(a);
+
+    EXPECT_TRUE(a.size() == 0);
+    ASSERT_EQ(empty.size(), 66);
+}
+
+/**
+ * @brief Comparador com estado: a direção da ordem é escolhida na
+ *        construção
+ */
+struct directed_less {
+    bool descending;
+
+    explicit directed_less(bool descending = false) : descending(descending) {}
+
+    bool operator()(int a, int b) const {
+        return descending ? b < a : a < b;
+    }
+};
+
+TEST(Comparators, Stateful) {
+    typedef avl_tree<int, directed_less> tree;
+
+    tree t(directed_less(true));
+    std::vector<int> keys;
+
+    for (int i = 0; i < 200; i++)
+        keys.push_back((i * 37) % 200);
+
+    for (int x : keys)
+        t.insert(x);
+
+    EXPECT_LE(t.height(), 10);
+    EXPECT_TRUE(t.key_comp().descending);
+    EXPECT_EQ(t.min(), 199);
+    EXPECT_EQ(t.max(), 0);
+
+    for (int i = 0; i < 200; i += 2)
+        t.remove(i);
+
+    std::vector<int> v(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(v.size(), 100u);
+    ASSERT_TRUE(std::is_sorted(v.rbegin(), v.rend()));
+
+    // Cópias, movimentos e árvores extraídas levam os comparadores
+    tree copy(t);
+    tree moved(std::move(copy));
+    tree part = moved.extract_range(150, 50);
+
+    EXPECT_TRUE(part.key_comp().descending);
+    EXPECT_EQ(part.size(), 50);
+    EXPECT_EQ(moved.size(), 50);
+    ASSERT_EQ(part.min(), 149);
+
+    moved.merge(part);
+    EXPECT_EQ(moved.size(), 100);
+    ASSERT_TRUE(moved.includes(101));
+
+    // A montagem em massa confere a ordem com o comparador da árvore
+    tree built(directed_less(true));
+    std::vector<int> down({ 5, 4, 3, 2, 1 });
+    built.build(down.begin(), down.end());
+
+    EXPECT_EQ(built.min(), 5);
+    ASSERT_THROW(tree().build(down.begin(), down.end()), const char*);
+}
+
+/**
+ * @brief Comparador que segue uma tabela de posições, sem construtor padrão
+ */
+struct table_less {
+    const std::vector<int>& rank;
+
+    explicit table_less(const std::vector<int>& rank) : rank(rank) {}
+
+    bool operator()(int a, int b) const {
+        return rank[a] < rank[b];
+    }
+};
+
+TEST(Comparators, Table) {
+    std::vector<int> rank({ 3, 0, 4, 1, 2 });
+    avl_tree<int, table_less> t{table_less(rank)};
+
+    for (int i = 0; i < 5; i++)
+        t.insert(i);
+
+    std::vector<int> v(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(v, std::vector<int>({ 1, 3, 4, 0, 2 }));
+
+    avl_tree<int, table_less> copy(t);
+    copy.remove(4);
+    t.clear();
+
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(copy.size(), 4);
+    ASSERT_EQ(copy.min(), 1);
+}
+
+TEST(Comparators, EmptyCostNothing) {
+    // Comparadores sem estado não ocupam memória no nó, e os com estado
+    // ficam fora dele, atrás de um ponteiro
+    EXPECT_EQ(sizeof(avl_tree<int>), sizeof(avl_tree<int, std::greater<int> >));
+    EXPECT_EQ(sizeof(avl_tree<int, directed_less>), sizeof(avl_tree<int>) + sizeof(void*));
+    ASSERT_EQ(sizeof(avl_tree<int, table_less>), sizeof(avl_tree<int, directed_less>));
+}
+
+/**
+ * @brief Confere o conteúdo e a forma de uma árvore contra um std::set
+ */
+template <class Tree> static void check_version(Tree& t, const std::set<int>& model, int slack) {
+    std::vector<int> items(t.begin_in_order(), t.end_in_order());
+    ASSERT_EQ(items, std::vector<int>(model.begin(), model.end()));
+    ASSERT_EQ(t.size(), (int) model.size());
+
+    if (!t.empty() && t.tombstones() == 0)
+        check_node(&t, slack);
+}
+
+/**
+ * @brief Aplica operações aleatórias em várias cópias de uma árvore, que
+ *        compartilham nós, e compara cada uma com o seu std::set
+ */
+template <class Tree> static void random_versions(int slack) {
+    std::mt19937 rng(2024);
+    std::vector<Tree> trees(1);
+    std::vector<std::set<int> > models(1);
+
+    // As referências às versões não podem ser invalidadas pelas cópias
+    trees.reserve(8);
+    models.reserve(8);
+
+    for (int i = 0; i < 300; i++) {
+        trees[0].insert(i * 7 % 300);
+        models[0].insert(i * 7 % 300);
+    }
+
+    for (int step = 0; step < 6000; step++) {
+        size_t a = rng() % trees.size(), b = rng() % trees.size();
+        Tree& t = trees[a];
+        std::set<int>& model = models[a];
+        int key = (int) (rng() % 400);
+
+        switch (rng() % 11) {
+        case 0:
+            if (trees.size() < 8) {
+                trees.push_back(trees[a]);
+                models.push_back(models[a]);
+            } else {
+                trees[b] = trees[a];
+                models[b] = models[a];
+            }
+            break;
+
+        case 1:
+            if (model.insert(key).second) {
+                t.insert(key);
+            } else {
+                ASSERT_THROW(t.insert(key), const char*);
+            }
+            break;
+
+        case 2:
+            model.insert(key);
+            t.update(key);
+            break;
+
+        case 3:
+            if (model.erase(key)) {
+                t.remove(key);
+            } else {
+                ASSERT_THROW(t.remove(key), const char*);
+            }
+            break;
+
+        case 4:
+            if (!model.empty()) {
+                ASSERT_EQ(t.pop(), *model.rbegin());
+                model.erase(std::prev(model.end()));
+            }
+            if (!model.empty()) {
+                ASSERT_EQ(t.popleft(), *model.begin());
+                model.erase(model.begin());
+            }
+            break;
+
+        case 5:
+            if (model.erase(key))
+                t.lazy_remove(key);
+            break;
+
+        case 6: {
+            auto first = model.lower_bound(key), last = model.upper_bound(key + 20);
+            int expected = (int) std::distance(first, last);
+
+            model.erase(first, last);
+            ASSERT_EQ(t.erase_range(key, key + 20), expected);
+            break;
+        }
+
+        case 7:
+            if (model.erase(key)) {
+                typename Tree::node_type node = t.extract(key);
+
+                // O nó vai para outra cópia, ou volta para a mesma
+                if (models[b].insert(key).second) {
+                    trees[b].insert(std::move(node));
+                } else {
+                    ASSERT_THROW(trees[b].insert(std::move(node)), const char*);
+                }
+            }
+            break;
+
+        case 8:
+            if (model.insert(key).second)
+                t.insert_hint(rng() % 2 ? t.begin_in_order() : t.end_in_order(), key);
+            break;
+
+        case 9:
+            t.compact();
+            break;
+
+        case 10:
+            if (a != b) {
+                std::set<int> moved;
+
+                for (int x : models[b])
+                    if (model.insert(x).second)
+                        moved.insert(x);
+
+                for (int x : moved)
+                    models[b].erase(x);
+
+                t.merge(trees[b]);
+            }
+            break;
+        }
+
+        check_version(t, model, slack);
+
+        if (step % 500 == 0)
+            for (size_t i = 0; i < trees.size(); i++)
+                check_version(trees[i], models[i], slack);
+    }
+
+    for (size_t i = 0; i < trees.size(); i++)
+        check_version(trees[i], models[i], slack);
+}
+
+TEST(CopyOnWrite, Independent) {
+    avl_tree<std::string> a;
+    for (int i = 0; i < 100; i++)
+        a.insert(std::to_string(1000 + i));
+
+    avl_tree<std::string> b(a), c;
+    c = b;
+
+    b.remove("1050");
+    b.insert("0999");
+    c.erase_range("1000", "1009");
+
+    EXPECT_EQ(a.size(), 100);
+    EXPECT_TRUE(a.includes("1050"));
+    EXPECT_FALSE(a.includes("0999"));
+    EXPECT_EQ(b.size(), 100);
+    EXPECT_FALSE(b.includes("1050"));
+    EXPECT_EQ(b.min(), "0999");
+    EXPECT_EQ(c.size(), 90);
+    ASSERT_EQ(a.min(), "1000");
+}
+
+TEST(CopyOnWrite, RandomStrict) {
+    random_versions<avl_tree<int> >(1);
+}
+
+TEST(CopyOnWrite, RandomRelaxed) {
+    random_versions<avl_tree<int, std::less<int>, std::equal_to<int>,
+        avl_no_stats, avl_relaxed_balance<2> > >(2);
+}
+
+TEST(CopyOnWrite, RandomWeak) {
+    random_versions<avl_tree<int, std::less<int>, std::equal_to<int>,
+        avl_no_stats, avl_weak_balance> >(0);
+}
+
+TEST(CopyOnWrite, Threads) {
+    avl_tree<int> base;
+    for (int i = 0; i < 20000; i += 2)
+        base.insert(i);
+
+    std::atomic<int> failures(0);
+    std::vector<std::thread> threads;
+
+    // Cada thread altera a sua cópia, e todas compartilham os nós da base
+    for (int id = 0; id < 4; id++) {
+        threads.emplace_back([&base, &failures, id] {
+            avl_tree<int> copy(base);
+            std::set<int> model(base.begin_in_order(), base.end_in_order());
+            std::mt19937 rng(id);
+
+            for (int i = 0; i < 5000; i++) {
+                int key = (int) (rng() % 20000);
+
+                if (model.insert(key).second)
+                    copy.insert(key);
+                else if (model.erase(key))
+                    copy.remove(key);
+            }
+
+            std::vector<int> items(copy.begin_in_order(), copy.end_in_order());
+
+            if (items != std::vector<int>(model.begin(), model.end()))
+                failures++;
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(base.size(), 10000);
+    check_node(&base, 1);
+}
+
+TEST(Reclaim, ClearIsImmediate) {
+    avl_tree<std::string> t;
+    for (int i = 0; i < 1000; i++)
+        t.insert(std::to_string(i));
+
+    avl_tree<std::string>::reclaimer garbage;
+    t.clear(garbage);
+
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(t.size(), 0);
+    EXPECT_FALSE(garbage.empty());
+
+    t.insert("a");
+    EXPECT_EQ(t.size(), 1);
+    check_node(&t, 1);
+
+    EXPECT_TRUE(garbage.reclaim(1));
+    EXPECT_FALSE(garbage.reclaim(1 << 20));
+    ASSERT_TRUE(garbage.empty());
+}
+
+TEST(Reclaim, BackgroundThread) {
+    avl_tree<std::string> base;
+    for (int i = 0; i < 20000; i++)
+        base.insert(std::to_string(i));
+
+    avl_tree<std::string> t(base);
+    for (int i = 0; i < 1000; i++)
+        t.remove(std::to_string(i * 7));
+
+    avl_tree<std::string>::reclaimer garbage;
+    t.clear(garbage);
+    base.clear(garbage);
+
+    // Os nós são liberados em outra thread, enquanto a árvore é reusada
+    std::thread worker([](avl_tree<std::string>::reclaimer g) {
+        while (g.reclaim(64));
+    }, std::move(garbage));
+
+    for (int i = 0; i < 1000; i++)
+        t.insert(std::to_string(i));
+
+    worker.join();
+
+    EXPECT_EQ(t.size(), 1000);
+    check_node(&t, 1);
+}
+
+TEST(Reclaim, DeepTree) {
+    // Com uma folga tão grande, a árvore fica mais alta que a pilha fixa
+    // da liberação, que mesmo assim não enche
+    avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats,
+        avl_relaxed_balance<200> > t;
+
+    for (int i = 20000; i > 0; i--)
+        t.insert(i);
+
+    EXPECT_GT(t.height(), 64);
+
+    t.clear();
+    EXPECT_TRUE(t.empty());
+
+    for (int i = 0; i < 100; i++)
+        t.insert(i);
+
+    ASSERT_EQ(t.size(), 100);
+}
+
+TEST(Validate, Operations) {
+    avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats, avl_weak_balance> t;
+    EXPECT_NO_THROW(t.validate());
+
+    for (int i = 0; i < 1000; i++)
+        t.insert(i * 7919 % 1000);
+
+    for (int i = 0; i < 1000; i += 3)
+        t.remove(i);
+
+    t.lazy_remove(1);
+    EXPECT_NO_THROW(t.validate());
+
+    // A cópia divide os nós, e as duas continuam válidas depois de escrever
+    avl_tree<int, std::less<int>, std::equal_to<int>, avl_no_stats, avl_weak_balance> copy(t);
+    copy.erase_range(100, 200);
+    EXPECT_NO_THROW(t.validate());
+    ASSERT_NO_THROW(copy.validate());
+}
+
+TEST(Validate, Corrupted) {
+    avl_tree<int> t;
+    for (int i = 0; i < 100; i++)
+        t.insert(i);
+
+    // Inserir direto na subárvore deixa a informação fora de ordem e o
+    // tamanho da raiz desatualizado
+    t.get_left()->insert(1000);
+    ASSERT_THROW(t.validate(), const char*);
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     
@@ -0,0 +1,158 @@
+#include <durable_avl_tree.hpp>
+#include <gtest/gtest.h>
+
+#include <csignal>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+static void remove_files(const std::string & path) {
+    std::remove((path + ".wal").c_str());
+    std::remove((path + ".snapshot").c_str());
+}
+
+TEST(Recover, LogOnly) {
+    const std::string path = "durable_test_log";
+    remove_files(path);
+
+    {
+        durable_avl_tree<int> t(path);
+        for (int i = 0; i < 100; i++)
+            t.insert(i);
+
+        t.remove(50);
+    }
+
+    durable_avl_tree<int> t(path);
+
+    EXPECT_EQ(t.size(), 99);
+    EXPECT_FALSE(t.includes(50));
+    ASSERT_TRUE(t.includes(99));
+
+    remove_files(path);
+}
+
+TEST(Recover, SnapshotAndLog) {
+    const std::string path = "durable_test_snapshot";
+    remove_files(path);
+
+    {
+        durable_avl_tree<int> t(path);
+        for (int i = 0; i < 100; i++)
+            t.insert(i);
+
+        t.checkpoint();
+
+        for (int i = 100; i < 150; i++)
+            t.insert(i);
+
+        t.remove(0);
+    }
+
+    durable_avl_tree<int> t(path);
+
+    EXPECT_EQ(t.size(), 149);
+    EXPECT_FALSE(t.includes(0));
+    ASSERT_TRUE(t.includes(149));
+
+    remove_files(path);
+}
+
+TEST(Recover, TornRecord) {
+    const std::string path = "durable_test_torn";
+    remove_files(path);
+
+    {
+        durable_avl_tree<int> t(path);
+        t.insert(1);
+        t.insert(2);
+    }
+
+    FILE* f = std::fopen((path + ".wal").c_str(), "ab");
+    std::fputs("garbage", f);
+    std::fclose(f);
+
+    {
+        durable_avl_tree<int> t(path);
+        EXPECT_EQ(t.size(), 2);
+        t.insert(3);
+    }
+
+    durable_avl_tree<int> t(path);
+
+    EXPECT_EQ(t.size(), 3);
+    ASSERT_TRUE(t.includes(3));
+
+    remove_files(path);
+}
+
+TEST(Recover, RejectedOperations) {
+    const std::string path = "durable_test_rejected";
+    remove_files(path);
+
+    {
+        durable_avl_tree<int> t(path);
+        t.insert(1);
+
+        EXPECT_THROW(t.insert(1), const char*);
+        EXPECT_THROW(t.remove(2), const char*);
+    }
+
+    durable_avl_tree<int> t(path);
+
+    EXPECT_EQ(t.size(), 1);
+    ASSERT_TRUE(t.includes(1));
+
+    remove_files(path);
+}
+
+TEST(Recover, FailedWrite) {
+    const std::string path = "durable_test_failed";
+    remove_files(path);
+
+    durability_options opts;
+    opts.group_size = 4;
+
+    {
+        durable_avl_tree<int> t(path, opts);
+        for (int i = 0; i < 4; i++)
+            t.insert(i);
+
+        // Deixa o log crescer só até o meio do próximo grupo
+        struct stat log;
+        stat((path + ".wal").c_str(), &log);
+
+        struct rlimit old, limit;
+        getrlimit(RLIMIT_FSIZE, &old);
+        limit = old;
+        limit.rlim_cur = log.st_size + 20;
+
+        std::signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &limit);
+
+        for (int i = 4; i < 7; i++)
+            t.insert(i);
+
+        EXPECT_THROW(t.insert(7), const char*);
+        setrlimit(RLIMIT_FSIZE, &old);
+
+        // O grupo que falhou continua pendente e é gravado com o próximo
+        EXPECT_TRUE(t.includes(7));
+
+        for (int i = 8; i < 11; i++)
+            t.insert(i);
+    }
+
+    durable_avl_tree<int> t(path);
+
+    EXPECT_EQ(t.size(), 11);
+    ASSERT_TRUE(t.includes(7));
+
+    remove_files(path);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+
+    return RUN_ALL_TESTS();
+}
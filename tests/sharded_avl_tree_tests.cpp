@@ -0,0 +1,146 @@
+#include <sharded_avl_tree.hpp>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <set>
+#include <thread>
+
+/**
+ * @brief Opções com shards pequenos, para forçar divisões e junções
+ */
+static sharding_options small_shards() {
+    sharding_options opts;
+    opts.split_size = 64;
+    opts.join_size = 16;
+    opts.max_shards = 1000;
+
+    return opts;
+}
+
+/**
+ * @brief Obtém todas as informações da árvore, em ordem
+ */
+static std::vector<int> items(sharded_avl_tree<int>& t) {
+    std::vector<int> v;
+    t.for_each([&](int x) { v.push_back(x); });
+
+    return v;
+}
+
+TEST(Sharded, Basic) {
+    sharded_avl_tree<int> t;
+
+    t.insert(3);
+    t.insert(1);
+    t.insert(2);
+
+    EXPECT_EQ(t.size(), 3);
+    EXPECT_TRUE(t.includes(2));
+    EXPECT_THROW(t.insert(2), const char*);
+
+    t.remove(2);
+    EXPECT_FALSE(t.includes(2));
+    EXPECT_THROW(t.remove(2), const char*);
+
+    t.update(5);
+    t.update(5);
+
+    EXPECT_EQ(t.size(), 3);
+    ASSERT_EQ(items(t), std::vector<int>({ 1, 3, 5 }));
+}
+
+TEST(Sharded, Bounds) {
+    sharded_avl_tree<int> t(std::vector<int>({ 10, 20, 30 }));
+
+    EXPECT_EQ(t.shard_count(), 4);
+
+    for (int i = 39; i >= 0; i--)
+        t.insert(i);
+
+    std::vector<int> v = items(t);
+    ASSERT_EQ(v.size(), 40u);
+
+    for (int i = 0; i < 40; i++)
+        ASSERT_EQ(v[i], i);
+
+    ASSERT_ANY_THROW(sharded_avl_tree<int>(std::vector<int>({ 2, 1 })));
+}
+
+TEST(Sharded, SplitAndJoin) {
+    sharded_avl_tree<int> t(small_shards());
+
+    for (int i = 0; i < 1000; i++)
+        t.insert(i);
+
+    EXPECT_GT(t.shard_count(), 10);
+
+    for (int i = 0; i < 1000; i++)
+        ASSERT_TRUE(t.includes(i));
+
+    for (int i = 0; i < 990; i++)
+        t.remove(i);
+
+    EXPECT_LT(t.shard_count(), 5);
+    EXPECT_EQ(t.size(), 10);
+
+    std::vector<int> v = items(t);
+    ASSERT_EQ(v.size(), 10u);
+    ASSERT_EQ(v.front(), 990);
+}
+
+TEST(Sharded, Random) {
+    std::mt19937 rng(31);
+    std::set<int> model;
+    sharded_avl_tree<int> t(small_shards());
+
+    for (int step = 0; step < 20000; step++) {
+        int x = (int) (rng() % 3000);
+
+        if (model.count(x)) {
+            t.remove(x);
+            model.erase(x);
+        } else {
+            t.insert(x);
+            model.insert(x);
+        }
+    }
+
+    ASSERT_EQ(t.size(), (int) model.size());
+    ASSERT_EQ(items(t), std::vector<int>(model.begin(), model.end()));
+}
+
+TEST(Sharded, Concurrent) {
+    const int threads = 4, per_thread = 5000;
+    sharded_avl_tree<int> t(small_shards());
+    std::vector<std::thread> workers;
+    std::atomic<int> wrong(0);
+
+    // Cada thread usa as chaves congruentes ao seu número
+    for (int w = 0; w < threads; w++) {
+        workers.push_back(std::thread([&t, &wrong, w]() {
+            for (int i = 0; i < per_thread; i++)
+                t.insert(i * threads + w);
+
+            for (int i = 0; i < per_thread; i += 2)
+                t.remove(i * threads + w);
+
+            for (int i = 0; i < per_thread; i++)
+                if (t.includes(i * threads + w) != (i % 2 == 1))
+                    wrong++;
+        }));
+    }
+
+    for (std::thread& w : workers)
+        w.join();
+
+    std::vector<int> v = items(t);
+    EXPECT_EQ(wrong.load(), 0);
+    ASSERT_EQ(t.size(), threads * per_thread / 2);
+    ASSERT_EQ(v.size(), (size_t) t.size());
+    ASSERT_TRUE(std::is_sorted(v.begin(), v.end()));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}